@@ -0,0 +1,358 @@
+#include "../include/gkov.h"
+#include "../include/hist.h"
+#include "../include/simulator.h"
+#include "../include/utils.h"
+#include "../include/aes.h"
+#include <benchmark/benchmark.h>
+#include <unistd.h>
+#include <atomic>
+#include <new>
+#include <filesystem>
+#include <fstream>
+#include <map>
+
+using namespace std;
+
+/**
+ * Synthetic leakage: X is the Hamming weight of a random S-box output, the first sample of Y is X plus gaussian noise
+ * and the remaining samples are noise only.
+ */
+struct Dataset {
+    vector<double> X;
+    vector<double> Y;
+    vector<double *> rows;
+    int size;
+    int dimensions;
+
+    Dataset(int size, int dimensions) : X(size), Y((size_t) size * dimensions), rows(size), size(size), dimensions(dimensions) {
+        mt19937 gen(size * 31 + dimensions);
+        normal_distribution<double> noise(0, 1);
+        for (int i = 0; i < size; i++) {
+            X[i] = hw(aes_intermediate(gen() & 0xFF, 0x2B));
+            rows[i] = Y.data() + (size_t) i * dimensions;
+            rows[i][0] = X[i] + noise(gen);
+            for (int j = 1; j < dimensions; j++)
+                rows[i][j] = noise(gen);
+        }
+    }
+};
+
+static atomic<uint64_t> allocations(0);
+
+void *operator new(size_t size) {
+    allocations.fetch_add(1, memory_order_relaxed);
+    if (void *pointer = malloc(size ? size : 1))
+        return pointer;
+    throw bad_alloc();
+}
+
+void operator delete(void *pointer) noexcept {
+    free(pointer);
+}
+
+void operator delete(void *pointer, size_t) noexcept {
+    free(pointer);
+}
+
+/**
+ * Reads the current resident set size of the process, in MB.
+ */
+double current_rss_mb() {
+    long pages = 0, resident = 0;
+    ifstream statm("/proc/self/statm");
+    statm >> pages >> resident;
+    return (double) resident * (double) sysconf(_SC_PAGESIZE) / (1024 * 1024);
+}
+
+/**
+ * Resets the high-water mark of the resident set size of the process to the current one, so that the peak read at the
+ * end of a benchmark does not carry the memory of the benchmarks that ran before it.
+ * @return The current resident set size, in MB.
+ */
+double reset_peak_rss_mb() {
+    ofstream("/proc/self/clear_refs") << "5";
+    return current_rss_mb();
+}
+
+/**
+ * Reads the high-water mark of the resident set size since the last reset_peak_rss_mb, in MB.
+ */
+double peak_rss_mb() {
+    ifstream status("/proc/self/status");
+    string line;
+    while (getline(status, line))
+        if (line.rfind("VmHWM:", 0) == 0)
+            return stod(line.substr(6)) / 1024;
+    return 0;
+}
+
+/**
+ * Reports the peak resident set size of the benchmark, its growth over the resident set size at its start and the
+ * throughput of the benchmark.
+ */
+void report(benchmark::State &state, int64_t items, double rss_start) {
+    double peak = peak_rss_mb();
+    state.counters["peak_rss_mb"] = peak;
+    state.counters["peak_delta_mb"] = peak - rss_start;
+    state.SetItemsProcessed(state.iterations() * items);
+    state.SetComplexityN(items);
+}
+
+/**
+ * Reports the heap allocations per iteration done by operator new since start. The caller sizes the workspace with a
+ * warm-up call before taking start, so every iteration of the loop is counted.
+ * @return The allocations per iteration.
+ */
+double report_allocations(benchmark::State &state, uint64_t start) {
+    double allocs = (double) (allocations.load(memory_order_relaxed) - start) / (double) max(state.iterations(), (benchmark::IterationCount) 1);
+    state.counters["allocs_per_call"] = allocs;
+    return allocs;
+}
+
+static void BM_GKOVEstimate(benchmark::State &state) {
+    double rss = reset_peak_rss_mb();
+    Dataset data((int) state.range(0), (int) state.range(1));
+    auto estimator = GKOVEstimator(log10);
+    int sizeOfY[2] = {data.size, data.dimensions};
+    for (auto _: state)
+        benchmark::DoNotOptimize(estimator.estimate(data.X.data(), data.rows.data(), data.size, sizeOfY));
+    report(state, data.size, rss);
+}
+
+static void BM_HistEstimate(benchmark::State &state) {
+    double rss = reset_peak_rss_mb();
+    Dataset data((int) state.range(0), 1);
+    auto range = minmax_element(data.Y.begin(), data.Y.end());
+    int bins[1] = {10};
+    pair<double, double> ranges[1] = {make_pair(*range.first, *range.second)};
+    auto estimator = HistEstimator(1, bins, ranges);
+    for (auto _: state)
+        benchmark::DoNotOptimize(estimator.estimate(data.X.data(), hw_pdf, data.Y.data(), data.size, 1));
+    report(state, data.size, rss);
+}
+
+static void BM_HistEstimateWorkspace(benchmark::State &state) {
+    double rss = reset_peak_rss_mb();
+    Dataset data((int) state.range(0), 1);
+    auto range = minmax_element(data.Y.begin(), data.Y.end());
+    int bins[1] = {10};
+    pair<double, double> ranges[1] = {make_pair(*range.first, *range.second)};
+    const auto estimator = HistEstimator(1, bins, ranges);
+    HistWorkspace workspace;
+    estimator.estimate(data.X.data(), hw_pdf, data.Y.data(), data.size, 1, workspace);
+    uint64_t start = allocations.load(memory_order_relaxed);
+    for (auto _: state)
+        benchmark::DoNotOptimize(estimator.estimate(data.X.data(), hw_pdf, data.Y.data(), data.size, 1, workspace));
+    if (report_allocations(state, start) > 0)
+        state.SkipWithError("HistWorkspace allocated after the warm-up call");
+    report(state, data.size, rss);
+}
+
+static void BM_GKOVEstimateWorkspace(benchmark::State &state) {
+    double rss = reset_peak_rss_mb();
+    Dataset data((int) state.range(0), (int) state.range(1));
+    const auto estimator = GKOVEstimator(log10);
+    int sizeOfY[2] = {data.size, data.dimensions};
+    auto marginals = GKOVEstimator::prepare_marginals(data.X.data(), data.rows.data(), data.size, sizeOfY);
+    GKOVWorkspace workspace;
+    estimator.estimate(data.X.data(), marginals, workspace);
+    uint64_t start = allocations.load(memory_order_relaxed);
+    for (auto _: state)
+        benchmark::DoNotOptimize(estimator.estimate(data.X.data(), marginals, workspace));
+    report_allocations(state, start);
+    report(state, data.size, rss);
+}
+
+/**
+ * Soak test: a fixed 10^5 estimates on one workspace, the RSS growth between the first and the last call should be
+ * flat (close to 0 MB). The histogram estimate must not allocate at all, mlpack still allocates in the GKOV queries.
+ */
+static void BM_HistSoak(benchmark::State &state) {
+    Dataset data((int) state.range(0), 1);
+    auto range = minmax_element(data.Y.begin(), data.Y.end());
+    int bins[1] = {10};
+    pair<double, double> ranges[1] = {make_pair(*range.first, *range.second)};
+    const auto estimator = HistEstimator(1, bins, ranges);
+    HistWorkspace workspace;
+    estimator.estimate(data.X.data(), hw_pdf, data.Y.data(), data.size, 1, workspace);
+    double rss = current_rss_mb();
+    uint64_t start = allocations.load(memory_order_relaxed);
+    for (auto _: state)
+        benchmark::DoNotOptimize(estimator.estimate(data.X.data(), hw_pdf, data.Y.data(), data.size, 1, workspace));
+    if (report_allocations(state, start) > 0)
+        state.SkipWithError("HistWorkspace allocated after the warm-up call");
+    state.counters["rss_growth_mb"] = current_rss_mb() - rss;
+}
+
+static void BM_GKOVSoak(benchmark::State &state) {
+    Dataset data((int) state.range(0), 1);
+    const auto estimator = GKOVEstimator(log10);
+    int sizeOfY[2] = {data.size, data.dimensions};
+    auto marginals = GKOVEstimator::prepare_marginals(data.X.data(), data.rows.data(), data.size, sizeOfY);
+    GKOVWorkspace workspace;
+    estimator.estimate(data.X.data(), marginals, workspace);
+    double rss = current_rss_mb();
+    uint64_t start = allocations.load(memory_order_relaxed);
+    for (auto _: state)
+        benchmark::DoNotOptimize(estimator.estimate(data.X.data(), marginals, workspace));
+    report_allocations(state, start);
+    state.counters["rss_growth_mb"] = current_rss_mb() - rss;
+}
+
+static void BM_SimulatorGenerate(benchmark::State &state) {
+    double rss = reset_peak_rss_mb();
+    auto n_trc = (uint32_t) state.range(0);
+    Simulator sim(0);
+    for (auto _: state) {
+        auto pts_traces = sim.generate_traces_1d(n_trc, 0x2B, "gauss", 1, aes_intermediate, hw);
+        benchmark::DoNotOptimize(pts_traces.second);
+        delete[] pts_traces.first;
+        delete[] pts_traces.second;
+    }
+    report(state, n_trc, rss);
+}
+
+static void BM_SimulatorGenerateAES(benchmark::State &state) {
+    double rss = reset_peak_rss_mb();
+    auto n_trc = (uint32_t) state.range(0);
+    AESSimulationConfig config;
+    config.samples = (uint32_t) state.range(1);
+    config.correlation = 0.5;
+    for (uint32_t b = 0; b < AES_KEY_BYTES; b++)
+        config.leak_positions.push_back(b * (config.samples / AES_KEY_BYTES));
+    const uint8_t key[AES_KEY_BYTES] = {0x2B, 0x7E, 0x15, 0x16, 0x28, 0xAE, 0xD2, 0xA6,
+                                        0xAB, 0xF7, 0x15, 0x88, 0x09, 0xCF, 0x4F, 0x3C};
+    Simulator sim(0);
+    for (auto _: state) {
+        auto pts_traces = sim.generate_traces_aes(n_trc, key, config, aes_intermediate, hw);
+        benchmark::DoNotOptimize(pts_traces.second);
+        delete[] pts_traces.first;
+        delete[] pts_traces.second;
+    }
+    report(state, n_trc, rss);
+    state.SetBytesProcessed(state.iterations() * n_trc * (int64_t) config.samples * (int64_t) sizeof(double));
+}
+
+static void BM_WriteTraces(benchmark::State &state) {
+    double rss = reset_peak_rss_mb();
+    Dataset data((int) state.range(0), 1);
+    auto filename = (filesystem::temp_directory_path() / "mi_bench_write.h5").string();
+    for (auto _: state)
+        MIUtils::write_traces(filename, data.Y.data(), data.X.data(), data.size, 0x2B);
+    filesystem::remove(filename);
+    report(state, data.size, rss);
+    state.SetBytesProcessed(state.iterations() * data.size * 2 * (int64_t) sizeof(double));
+}
+
+static void BM_ReadTraces(benchmark::State &state) {
+    double rss = reset_peak_rss_mb();
+    Dataset data((int) state.range(0), 1);
+    auto filename = (filesystem::temp_directory_path() / "mi_bench_read.h5").string();
+    MIUtils::write_traces(filename, data.Y.data(), data.X.data(), data.size, 0x2B);
+    for (auto _: state) {
+        Trace trace = MIUtils::read_traces(filename);
+        benchmark::DoNotOptimize(trace.traces);
+        delete[] trace.traces;
+        delete[] trace.pts;
+        delete[] trace.dims;
+    }
+    filesystem::remove(filename);
+    report(state, data.size, rss);
+    state.SetBytesProcessed(state.iterations() * data.size * 2 * (int64_t) sizeof(double));
+}
+
+BENCHMARK(BM_GKOVEstimate)->ArgsProduct({benchmark::CreateRange(10, 100000, 10), {1, 4}})
+        ->Unit(benchmark::kMillisecond)->Complexity();
+BENCHMARK(BM_HistEstimate)->RangeMultiplier(10)->Range(10, 10000000)->Unit(benchmark::kMillisecond)->Complexity();
+BENCHMARK(BM_HistEstimateWorkspace)->RangeMultiplier(10)->Range(10, 10000000)->Unit(benchmark::kMillisecond)->Complexity();
+BENCHMARK(BM_GKOVEstimateWorkspace)->ArgsProduct({benchmark::CreateRange(10, 100000, 10), {1, 4}})
+        ->Unit(benchmark::kMillisecond)->Complexity();
+BENCHMARK(BM_HistSoak)->Arg(1000)->Iterations(100000)->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_GKOVSoak)->Arg(256)->Iterations(100000)->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_SimulatorGenerate)->RangeMultiplier(10)->Range(10, 10000000)->Unit(benchmark::kMillisecond)->Complexity();
+BENCHMARK(BM_SimulatorGenerateAES)->ArgsProduct({benchmark::CreateRange(10, 1000000, 10), {16, 1024}})
+        ->Unit(benchmark::kMillisecond)->Complexity();
+BENCHMARK(BM_WriteTraces)->RangeMultiplier(10)->Range(10, 10000000)->Unit(benchmark::kMillisecond)->Complexity();
+BENCHMARK(BM_ReadTraces)->RangeMultiplier(10)->Range(10, 10000000)->Unit(benchmark::kMillisecond)->Complexity();
+
+/**
+ * Console reporter that additionally fits the scaling exponent k of time ~ N^k for every benchmark family (and
+ * dimensionality) with a least squares fit in log-log space, and optionally writes the exponents as JSON.
+ */
+class ScalingReporter : public benchmark::ConsoleReporter {
+public:
+    explicit ScalingReporter(string filename) : filename(std::move(filename)) {}
+
+    void ReportRuns(const vector<Run> &reports) override {
+        ConsoleReporter::ReportRuns(reports);
+        for (const auto &run: reports) {
+            if (run.run_type != Run::RT_Iteration || run.error_occurred || run.complexity_n <= 0)
+                continue;
+            auto name = run.run_name.function_name;
+            auto slash = run.run_name.args.find('/');
+            if (slash != string::npos)
+                name += "/d" + run.run_name.args.substr(slash + 1);
+            samples[name].emplace_back(log((double) run.complexity_n), log(run.GetAdjustedRealTime()));
+        }
+    }
+
+    void Finalize() override {
+        ConsoleReporter::Finalize();
+        map<string, double> exponents;
+        for (const auto &[name, points]: samples) {
+            if (points.size() < 2)
+                continue;
+            double mx = 0, my = 0, sxy = 0, sxx = 0;
+            for (const auto &[x, y]: points) {
+                mx += x;
+                my += y;
+            }
+            mx /= (double) points.size();
+            my /= (double) points.size();
+            for (const auto &[x, y]: points) {
+                sxy += (x - mx) * (y - my);
+                sxx += (x - mx) * (x - mx);
+            }
+            exponents[name] = sxx > 0 ? sxy / sxx : 0;
+        }
+        GetOutputStream() << "Scaling exponents (time ~ N^k):\n";
+        for (const auto &[name, k]: exponents)
+            GetOutputStream() << "  " << name << ": " << k << "\n";
+        if (filename.empty())
+            return;
+        ofstream out(filename);
+        out << "{";
+        bool first = true;
+        for (const auto &[name, k]: exponents) {
+            out << (first ? "" : ", ") << "\"" << name << "\": " << k;
+            first = false;
+        }
+        out << "}\n";
+    }
+
+private:
+    string filename;
+    map<string, vector<pair<double, double>>> samples;
+};
+
+int main(int argc, char **argv) {
+    benchmark::Initialize(&argc, argv);
+    string scaling_out;
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        if (arg.rfind("--scaling_out=", 0) == 0)
+            scaling_out = arg.substr(strlen("--scaling_out="));
+        else if (arg == "--gkov_large")
+            // The GKOV range counts grow roughly quadratically with discrete X, these sizes take hours
+            benchmark::RegisterBenchmark("BM_GKOVEstimate", BM_GKOVEstimate)
+                    ->ArgsProduct({{1000000, 10000000}, {1, 4}})->Unit(benchmark::kMillisecond);
+        else {
+            cout << "Usage: ./bench [benchmark options] [--scaling_out=<file.json>] [--gkov_large]" << "\n";
+            return 1;
+        }
+    }
+    ScalingReporter reporter(scaling_out);
+    benchmark::RunSpecifiedBenchmarks(&reporter);
+    benchmark::Shutdown();
+    return 0;
+}
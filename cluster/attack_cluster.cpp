@@ -1,73 +1,119 @@
 #include "../../small_project_cluster/include/gkov.h"
 #include "../../small_project_cluster/include/hist.h"
 #include "../../small_project_cluster/include/utils.h"
+#include "../../small_project_cluster/include/ranking.h"
+#include "../../small_project_cluster/include/aes.h"
+#include "../../small_project_cluster/include/cache.h"
+#include "../../small_project_cluster/include/scan.h"
+#include "../../small_project_cluster/include/gauss.h"
+#include "../../small_project_cluster/include/kde.h"
 #include <iostream>
 #include <filesystem>
+#include <sstream>
+#include <fstream>
 
 using namespace std;
 
-const uint8_t aes_sbox[256] = {
-    0x63, 0x7c, 0x77, 0x7b, 0xf2, 0x6b, 0x6f, 0xc5, 0x30, 0x01, 0x67, 0x2b, 0xfe, 0xd7, 0xab, 0x76,
-    0xca, 0x82, 0xc9, 0x7d, 0xfa, 0x59, 0x47, 0xf0, 0xad, 0xd4, 0xa2, 0xaf, 0x9c, 0xa4, 0x72, 0xc0,
-    0xb7, 0xfd, 0x93, 0x26, 0x36, 0x3f, 0xf7, 0xcc, 0x34, 0xa5, 0xe5, 0xf1, 0x71, 0xd8, 0x31, 0x15,
-    0x04, 0xc7, 0x23, 0xc3, 0x18, 0x96, 0x05, 0x9a, 0x07, 0x12, 0x80, 0xe2, 0xeb, 0x27, 0xb2, 0x75,
-    0x09, 0x83, 0x2c, 0x1a, 0x1b, 0x6e, 0x5a, 0xa0, 0x52, 0x3b, 0xd6, 0xb3, 0x29, 0xe3, 0x2f, 0x84,
-    0x53, 0xd1, 0x00, 0xed, 0x20, 0xfc, 0xb1, 0x5b, 0x6a, 0xcb, 0xbe, 0x39, 0x4a, 0x4c, 0x58, 0xcf,
-    0xd0, 0xef, 0xaa, 0xfb, 0x43, 0x4d, 0x33, 0x85, 0x45, 0xf9, 0x02, 0x7f, 0x50, 0x3c, 0x9f, 0xa8,
-    0x51, 0xa3, 0x40, 0x8f, 0x92, 0x9d, 0x38, 0xf5, 0xbc, 0xb6, 0xda, 0x21, 0x10, 0xff, 0xf3, 0xd2,
-    0xcd, 0x0c, 0x13, 0xec, 0x5f, 0x97, 0x44, 0x17, 0xc4, 0xa7, 0x7e, 0x3d, 0x64, 0x5d, 0x19, 0x73,
-    0x60, 0x81, 0x4f, 0xdc, 0x22, 0x2a, 0x90, 0x88, 0x46, 0xee, 0xb8, 0x14, 0xde, 0x5e, 0x0b, 0xdb,
-    0xe0, 0x32, 0x3a, 0x0a, 0x49, 0x06, 0x24, 0x5c, 0xc2, 0xd3, 0xac, 0x62, 0x91, 0x95, 0xe4, 0x79,
-    0xe7, 0xc8, 0x37, 0x6d, 0x8d, 0xd5, 0x4e, 0xa9, 0x6c, 0x56, 0xf4, 0xea, 0x65, 0x7a, 0xae, 0x08,
-    0xba, 0x78, 0x25, 0x2e, 0x1c, 0xa6, 0xb4, 0xc6, 0xe8, 0xdd, 0x74, 0x1f, 0x4b, 0xbd, 0x8b, 0x8a,
-    0x70, 0x3e, 0xb5, 0x66, 0x48, 0x03, 0xf6, 0x0e, 0x61, 0x35, 0x57, 0xb9, 0x86, 0xc1, 0x1d, 0x9e,
-    0xe1, 0xf8, 0x98, 0x11, 0x69, 0xd9, 0x8e, 0x94, 0x9b, 0x1e, 0x87, 0xe9, 0xce, 0x55, 0x28, 0xdf,
-    0x8c, 0xa1, 0x89, 0x0d, 0xbf, 0xe6, 0x42, 0x68, 0x41, 0x99, 0x2d, 0x0f, 0xb0, 0x54, 0xbb, 0x16
-};
-
-uint8_t aes_add_round_key(uint8_t state, uint8_t key) {
-    return state ^ key;
-}
-
-uint8_t aes_sub_byte(uint8_t state) {
-    return aes_sbox[state];
-}
-
-unsigned int aes_intermediate(unsigned int state, unsigned int key) {
-    return aes_sub_byte(aes_add_round_key(state, key));
+void print_ranking(const string &name, const RankingResult &result) {
+    cout << name << " ranking:";
+    for (size_t i = 0; i < 5 && i < result.ranking.size(); i++)
+        cout << " " << result.ranking[i].key << " (" << result.ranking[i].score << ")";
+    cout << "\n";
+    cout << name << " evaluations: " << result.evaluations << "\n";
+    cout << name << " evaluated traces: " << result.evaluated_traces << "\n";
+    cout << name << " rounds: " << result.rounds << ", traces used: " << result.traces_used
+         << ", converged: " << (result.converged ? "yes" : "no") << "\n";
 }
 
-unsigned int hw(unsigned int x) {
-    int count = 0;
-    while (x) {
-        count += x & 1;
-        x >>= 1;
+/**
+ * Writes the instrumentation counters and timers as JSON to the file named by MI_INSTRUMENTATION_JSON, or to stderr,
+ * which only carries progress lines when MI_PROGRESS is set.
+ */
+void write_instrumentation() {
+    if (getenv("MI_INSTRUMENTATION_JSON")) {
+        ofstream out(getenv("MI_INSTRUMENTATION_JSON"));
+        Instrumentation::write_json(out);
+    } else {
+        Instrumentation::write_json(cerr);
     }
-    return count;
 }
 
 int main(int argc, char **argv) {
     // Read filename from first argument
-    if (argc != 3) {
-        cout << "Usage: ./attack <filename> <key>" << "\n";
+    if (argc < 3) {
+        cout << "Usage: ./attack <filename> <key|rank|scan> [byte] [points of interest...]" << "\n";
         return 1;
     }
     string filename = argv[1];
-    int key = stoi(argv[2]);
+    bool rank = string(argv[2]) == "rank";
+    bool scan = string(argv[2]) == "scan";
+    int key = rank || scan ? 0 : stoi(argv[2]);
+    int byte = argc > 3 ? stoi(argv[3]) : 0;
+    vector<int> points_of_interest;
+    for (int i = 4; i < argc; i++)
+        points_of_interest.push_back(stoi(argv[i]));
+    // Number of best Gaussian candidates handed to successive halving in rank mode
+    int handoff_candidates = getenv("MI_HANDOFF_CANDIDATES") ? stoi(getenv("MI_HANDOFF_CANDIDATES")) : 32;
+    if (handoff_candidates <= 0) {
+        cout << "MI_HANDOFF_CANDIDATES must be greater than 0" << "\n";
+        return 1;
+    }
     if (!filesystem::exists(filename)) {
         cout << "File " << filename << " does not exist" << "\n";
         return 1;
     }
-    cout << "Processing " << filename << " with key " << key << "\n";
+    ProgressReporter::set_enabled(getenv("MI_PROGRESS") != nullptr);
+    if (rank)
+        cout << "Ranking keys of " << filename << "\n";
+    else if (scan)
+        cout << "Scanning samples of " << filename << "\n";
+    else
+        cout << "Processing " << filename << " with key " << key << "\n";
     // Read the traces
     Trace trace = MIUtils::read_traces(filename);
+    // Multi-byte traces are attacked one key byte at a time
+    MIUtils::select_byte(trace, byte);
     int dims[2] = {(int) trace.dims[0], (int) trace.dims[1]};
+
+    if (scan) {
+        // Leakage assessment under the known key, to pick points of interest before a multivariate attack
+        auto X = new double[dims[0]];
+        for (int j = 0; j < dims[0]; j++)
+            X[j] = hw(aes_intermediate((int) trace.pts[j], trace.secret_key));
+        auto mi = LeakageScanner(10).scan(X, trace.traces, dims[0], dims[1]);
+        cout << "MI curve: [";
+        for (int j = 0; j < dims[1]; j++)
+            cout << (j ? ", " : "") << mi[j];
+        cout << "]\n";
+        cout << "Points of interest:";
+        for (int j: LeakageScanner::points_of_interest(mi, 10))
+            cout << " " << j;
+        cout << "\n";
+        write_instrumentation();
+        return 0;
+    }
+    // Multi-sample traces are attacked on the points of interest found by scan, the histogram and KDE estimators on
+    // the first of them
+    if (dims[1] > 1) {
+        if (points_of_interest.empty() || (int) points_of_interest.size() > GAUSS_MAX_DIMENSIONS) {
+            cout << "Traces have " << dims[1] << " samples, pass 1 to " << GAUSS_MAX_DIMENSIONS
+                 << " points of interest found by scan" << "\n";
+            return 1;
+        }
+        MIUtils::select_samples(trace, points_of_interest);
+        dims[1] = (int) trace.dims[1];
+    }
     auto Y_gkov = MIUtils::to_gkov_format(trace.traces, dims, 2);
-    auto Y_hist = trace.traces;
+    auto Y_hist = new double[dims[0]];
+    vector<double *> Y_hist_rows(dims[0]);
+    for (int i = 0; i < dims[0]; i++) {
+        Y_hist[i] = trace.traces[(size_t) i * dims[1]];
+        Y_hist_rows[i] = Y_hist + i;
+    }
     // Find min and max values of Y_hist
     double min = Y_hist[0];
     double max = Y_hist[0];
-    for (int i = 1; i < dims[0] * dims[1]; i++) {
+    for (int i = 1; i < dims[0]; i++) {
         if (Y_hist[i] < min)
             min = Y_hist[i];
         if (Y_hist[i] > max)
@@ -76,21 +122,67 @@ int main(int argc, char **argv) {
 
     int bins[1] = {10};
     pair<double, double> ranges[1] = {make_pair(min, max)};
-    double pX[9] = {1.0/256, 8.0/256, 28.0/256, 56.0/256, 70.0/256, 56.0/256, 28.0/256, 8.0/256, 1.0/256};
 
     auto gkov_estimator = GKOVEstimator(log10);
     auto hist_estimator = HistEstimator(1, bins, ranges);
 
+    if (rank) {
+        // Gaussian templates as an O(N) first pass, then successive halving over growing prefixes of the traces
+        // on the best candidates, compared against 256 estimates on all of them
+        auto gauss_estimator = GaussEstimator(dims[1]);
+        gauss_estimator.accumulate(trace.pts, Y_gkov, dims[0]);
+        auto gauss_mi = gauss_estimator.estimate_all(aes_intermediate, hw);
+        auto gauss_ranking = KeyRanker::from_scores(gauss_mi, dims[0]);
+        print_ranking("Gauss", gauss_ranking);
+        auto kde_estimator = KDEEstimator();
+        kde_estimator.fit(trace.pts, Y_hist, dims[0]);
+        print_ranking("KDE", KeyRanker::from_scores(kde_estimator.estimate_all(aes_intermediate, hw), dims[0]));
+
+        HalvingParameters parameters;
+        for (size_t i = 0; i < (size_t) handoff_candidates && i < gauss_ranking.ranking.size(); i++)
+            parameters.candidates.push_back(gauss_ranking.ranking[i].key);
+        auto gkov_ranking = KeyRanker(KeyRanker::gkov(gkov_estimator), aes_intermediate, hw)
+                .rank(trace.pts, Y_gkov, dims[0], dims[1], parameters);
+        auto hist_ranking = KeyRanker(KeyRanker::hist(hist_estimator, hw_pdf), aes_intermediate, hw)
+                .rank(trace.pts, Y_hist_rows.data(), dims[0], 1, parameters);
+        print_ranking("GKOV", gkov_ranking);
+        print_ranking("Hist", hist_ranking);
+        cout << "Exhaustive evaluations: " << PLAINTEXT_SPACE << "\n";
+        cout << "Exhaustive evaluated traces: " << (uint64_t) PLAINTEXT_SPACE * dims[0] << "\n";
+        write_instrumentation();
+        return 0;
+    }
+
     auto X = new double[dims[0]];
     for (int j = 0; j < dims[0]; j++) {
         X[j] = hw(aes_intermediate((int) trace.pts[j], key));
     }
 
-    double gkov_estimate = gkov_estimator.estimate(X, Y_gkov, dims[0], dims);
-    double hist_estimate = hist_estimator.estimate(X, pX, Y_hist, dims[0], 1);
+    // Skip the estimates already computed for the same traces, key and parameters
+    auto cache = ResultCache(getenv("MI_CACHE_DIR") ? getenv("MI_CACHE_DIR") : "data/cache");
+    auto trace_hash = ResultCache::hash_trace(trace);
+    stringstream hist_parameters;
+    hist_parameters << hist_estimator.parameters() << ";pX=" << hexfloat;
+    for (int i = 0; i < 9; i++)
+        hist_parameters << (i ? "," : "") << hw_pdf[i];
+    auto gkov_key = ResultCache::make_key(trace_hash, key, "GKOV", gkov_estimator.parameters(dims[0]));
+    auto hist_key = ResultCache::make_key(trace_hash, key, "Hist", hist_parameters.str());
+
+    double gkov_estimate;
+    double hist_estimate;
+    if (!cache.lookup(gkov_key, gkov_estimate)) {
+        gkov_estimate = gkov_estimator.estimate(X, Y_gkov, dims[0], dims);
+        cache.store(gkov_key, gkov_estimate);
+    }
+    if (!cache.lookup(hist_key, hist_estimate)) {
+        hist_estimate = hist_estimator.estimate(X, hw_pdf, Y_hist, dims[0], 1);
+        cache.store(hist_key, hist_estimate);
+    }
 
+    cout << "Cache hits: " << cache.hits() << ", misses: " << cache.misses() << "\n";
     cout << "GKOV estimate: " << gkov_estimate << "\n";
     cout << "Hist estimate: " << hist_estimate << "\n";
+    write_instrumentation();
 
     return 0;
 }
\ No newline at end of file
@@ -13,10 +13,12 @@ def attack(filename, key):
 	result = result.read().replace("\n", "")
 	if "GKOV estimate: " not in result:
 		print(f"Error in attack: {result}")
+	cache = result.split("Cache hits: ")[1].split("GKOV estimate: ")[0].split(", misses: ")
+	cache = [int(item) for item in cache]
 	result = result.split("GKOV estimate: ")[1]
 	result = result.split("Hist estimate: ")
 	result = [float(item) for item in result]
-	return key, result[0], result[1]
+	return key, result[0], result[1], cache[0], cache[1]
 
 
 if __name__ == '__main__':
@@ -29,6 +31,9 @@ if __name__ == '__main__':
 		json_results = {}
 		for item in results:
 			json_results[item[0]] = {"GKOV": item[1], "Hist": item[2]}
+		hits = sum(item[3] for item in results)
+		misses = sum(item[4] for item in results)
+		print(f"Cache hits: {hits}, misses: {misses} ({100 * hits / (hits + misses):.1f}% hit rate)")
 		with open(f"{os.getcwd()}/data/results/{10*(2**index)}_traces.json", "w") as file:
 			json.dump(json_results, file, indent=4)
 		print(f"Finished attack with {10*(2**index)} traces")
\ No newline at end of file
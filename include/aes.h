@@ -0,0 +1,25 @@
+#ifndef AES_H
+#define AES_H
+
+#include <cstdint>
+
+// Number of values of a plaintext or key byte
+constexpr int PLAINTEXT_SPACE = 256;
+
+// Number of bytes of an AES-128 key and block
+constexpr int AES_KEY_BYTES = 16;
+
+extern const uint8_t aes_sbox[256];
+
+uint8_t aes_add_round_key(uint8_t state, uint8_t key);
+
+uint8_t aes_sub_byte(uint8_t state);
+
+unsigned int aes_intermediate(unsigned int state, unsigned int key);
+
+unsigned int hw(unsigned int x);
+
+// Distribution of the Hamming weight of a uniform byte, binomial(8, 1/2)
+extern const double hw_pdf[9];
+
+#endif
@@ -0,0 +1,37 @@
+#ifndef CACHE_H
+#define CACHE_H
+
+#include <cstdint>
+#include <string>
+#include <filesystem>
+#include "utils.h"
+
+using namespace std;
+
+class ResultCache {
+public:
+    explicit ResultCache(const string &directory);
+
+    static uint64_t hash_trace(const Trace &trace);
+
+    static string make_key(uint64_t trace_hash, unsigned int key, const string &estimator, const string &parameters);
+
+    bool lookup(const string &key, double &value);
+
+    void store(const string &key, double value) const;
+
+    [[nodiscard]] uint64_t hits() const;
+
+    [[nodiscard]] uint64_t misses() const;
+
+private:
+    filesystem::path directory;
+    uint64_t hitCount;
+    uint64_t missCount;
+
+    [[nodiscard]] filesystem::path entry_path(const string &key) const;
+
+    static uint64_t hash_bytes(const void *data, size_t size, uint64_t seed);
+};
+
+#endif
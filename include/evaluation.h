@@ -0,0 +1,64 @@
+#ifndef EVALUATION_H
+#define EVALUATION_H
+
+#include <vector>
+#include <string>
+#include <ostream>
+#include <cstdint>
+#include "ranking.h"
+#include "simulator.h"
+
+using namespace std;
+
+struct EvaluationSummary {
+    vector<uint32_t> trace_counts;
+    int repetitions = 0;
+    vector<double> gkov_success_rate = {};
+    vector<double> gkov_guessing_entropy = {};
+    vector<double> hist_success_rate = {};
+    vector<double> hist_guessing_entropy = {};
+};
+
+class Evaluator {
+public:
+    Evaluator(
+            double (*t_n)(int),
+            int bins,
+            const double *pX,
+            unsigned int (*crypto_fun)(const unsigned int, const unsigned int),
+            unsigned int (*lkg_fun)(const unsigned int)
+    );
+
+    EvaluationSummary evaluate(
+            const vector<uint32_t> &trace_counts,
+            int repetitions,
+            const string &distribution_type,
+            double sigma,
+            unsigned int seed
+    ) const;
+
+    static void write_summary(ostream &out, const EvaluationSummary &summary);
+
+private:
+    double (*t_n_)(int);
+    int bins_;
+    const double *pX_;
+    unsigned int (*crypto_fun_)(const unsigned int, const unsigned int);
+    unsigned int (*lkg_fun_)(const unsigned int);
+
+    void run_experiment(
+            uint32_t n_trc,
+            const vector<uint32_t> &trace_counts,
+            const string &distribution_type,
+            double sigma,
+            unsigned int seed,
+            vector<int> &gkov_ranks,
+            vector<int> &hist_ranks
+    ) const;
+
+    static int key_rank(const RankingResult &result, unsigned int secret_key);
+
+    static void write_array(ostream &out, const vector<double> &values);
+};
+
+#endif
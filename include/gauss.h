@@ -0,0 +1,89 @@
+#ifndef GAUSS_H
+#define GAUSS_H
+
+#include <vector>
+#include <cmath>
+#include <cstdint>
+#include <random>
+#include <stdexcept>
+#include <algorithm>
+#include <string>
+#include "instrumentation.h"
+#include "aes.h"
+
+using namespace std;
+
+// Every plaintext keeps a dimensions x dimensions co-moment matrix, 128MB for the 256 plaintexts at this limit
+constexpr int GAUSS_MAX_DIMENSIONS = 256;
+
+class GaussianMoments {
+public:
+    explicit GaussianMoments(int dimensions = 1);
+
+    void add(const double *y);
+
+    void merge(const GaussianMoments &other);
+
+    [[nodiscard]] uint64_t count() const;
+
+    [[nodiscard]] const vector<double> &mean() const;
+
+    [[nodiscard]] vector<double> covariance() const;
+
+private:
+    int dimensions;
+    uint64_t n;
+    vector<double> mu;
+    vector<double> m2;
+    vector<double> delta;
+};
+
+struct GaussianComponent {
+    double weight;
+    vector<double> mean;
+    vector<double> cholesky;
+    double log_det;
+};
+
+class GaussEstimator {
+public:
+    explicit GaussEstimator(int dimensions, int samples = 256);
+
+    void add(unsigned int pt, const double *y);
+
+    void accumulate(const double *pts, double **Y, int size);
+
+    void merge(const GaussEstimator &other);
+
+    void reset();
+
+    [[nodiscard]] double estimate(
+            unsigned int key,
+            unsigned int (*crypto_fun)(const unsigned int, const unsigned int),
+            unsigned int (*lkg_fun)(const unsigned int)
+    ) const;
+
+    [[nodiscard]] vector<double> estimate_all(
+            unsigned int (*crypto_fun)(const unsigned int, const unsigned int),
+            unsigned int (*lkg_fun)(const unsigned int)
+    ) const;
+
+    [[nodiscard]] const vector<GaussianMoments> &plaintext_moments() const;
+
+    [[nodiscard]] double mixture_mi(const vector<GaussianMoments> &classes) const;
+
+private:
+    int dimensions;
+    int samples;
+    vector<GaussianMoments> moments;
+
+    [[nodiscard]] double mixture_mi_1d(const vector<GaussianComponent> &components) const;
+
+    [[nodiscard]] double mixture_mi_nd(const vector<GaussianComponent> &components) const;
+
+    [[nodiscard]] double log_density(const GaussianComponent &component, const double *y, double *scratch) const;
+
+    static void cholesky(vector<double> &matrix, int dimensions, double &log_det);
+};
+
+#endif
@@ -2,33 +2,82 @@
 #define GKOV_H
 
 #include <utility>
+#include <memory_resource>
 #include <mlpack/core.hpp>
 #include <mlpack/methods/neighbor_search/neighbor_search.hpp>
 #include <mlpack/methods/range_search/range_search.hpp>
 #include <boost/math/special_functions/digamma.hpp>
+#include "instrumentation.h"
 
 using namespace arma;
 using namespace std;
 using namespace mlpack;
 
+struct GKOVMarginals {
+    mat x_data;
+    mat y_data;
+    RangeSearch<ChebyshevDistance, mat, BallTree> x;
+    RangeSearch<ChebyshevDistance, mat, BallTree> y;
+};
+
+class GKOVWorkspace {
+public:
+    GKOVWorkspace();
+
+    GKOVWorkspace(const GKOVWorkspace &) = delete;
+
+    GKOVWorkspace &operator=(const GKOVWorkspace &) = delete;
+
+private:
+    friend class GKOVEstimator;
+
+    pmr::monotonic_buffer_resource arena;
+    int capacity;
+    int rows;
+    double *xy;
+    double *d_ixy;
+    double *d_i;
+    double *n_ix;
+    double *n_iy;
+    double *a_i;
+    Mat<size_t> neighbors;
+    mat distances;
+    vector<vector<size_t>> range_neighbors;
+    vector<vector<double>> range_distances;
+};
+
 class GKOVEstimator {
 public:
     explicit GKOVEstimator(double (*callback)(int));
 
-    double estimate(double *X, double **Y, int sizeOfX, int sizeOfY[2]);
+    double estimate(double *X, double **Y, int sizeOfX, int sizeOfY[2]) const;
+
+    double estimate(double *X, double **Y, int sizeOfX, int sizeOfY[2], GKOVWorkspace &workspace) const;
+
+    static GKOVMarginals prepare_marginals(double *X, double **Y, int sizeOfX, int sizeOfY[2]);
+
+    static GKOVMarginals share_marginals(GKOVMarginals &marginals);
+
+    double estimate(const double *X, GKOVMarginals &marginals) const;
+
+    double estimate(const double *X, GKOVMarginals &marginals, GKOVWorkspace &workspace) const;
+
+    [[nodiscard]] string parameters(int size) const;
 
 private:
     double (*t_n_)(int);
 
-    double t_n(int n);
+    double t_n(int n) const;
+
+    static void reserve(GKOVWorkspace &workspace, int size, int rows);
 
     static mat prepare_data(double *X, double **Y, int sizeOfX, int sizeOfY[2]);
 
     static void check_dimensions(int sizeOfX, const int sizeOfY[2]);
 
-    static NeighborSearch<NearestNeighborSort, ChebyshevDistance, mat, BallTree> prepare_ball_search(mat data);
+    static NeighborSearch<NearestNeighborSort, ChebyshevDistance, mat, BallTree> prepare_ball_search(const mat &data);
 
-    static RangeSearch<ChebyshevDistance, mat, BallTree> prepare_ball_range_search(mat data);
+    static RangeSearch<ChebyshevDistance, mat, BallTree> prepare_ball_range_search(const mat &data);
 };
 
 #endif
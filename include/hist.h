@@ -5,9 +5,14 @@
 #include <stdexcept>
 #include <cmath>
 #include <algorithm>
+#include <vector>
+#include <string>
+#include <sstream>
+#include <memory_resource>
 #include <gsl/gsl_histogram.h>
 #include <gsl/gsl_histogram2d.h>
 #include <iostream>
+#include "instrumentation.h"
 
 using namespace std;
 
@@ -20,39 +25,79 @@ struct Histogram {
     int dimensions;
 };
 
+class HistWorkspace {
+public:
+    HistWorkspace();
+
+    ~HistWorkspace();
+
+    HistWorkspace(const HistWorkspace &) = delete;
+
+    HistWorkspace &operator=(const HistWorkspace &) = delete;
+
+private:
+    friend class HistEstimator;
+
+    pmr::monotonic_buffer_resource arena;
+    int capacity;
+    int totalBins;
+    int dimensions;
+    int bins[2];
+    int *counts;
+    double *pdf;
+    double *uniqueX;
+    double *classEntropy;
+    double *values;
+    int *binIndexes;
+    gsl_histogram *gsl_histogram_1d;
+    gsl_histogram2d *gsl_histogram_2d;
+    Histogram histogram;
+};
 
 class HistEstimator {
 public:
-    HistEstimator(int dimensions, int bins[], pair<double, double> ranges[]);
+    HistEstimator(int dimensions, const int bins[], const pair<double, double> ranges[]);
+
+    double estimate(const double *X, const double *pX, const double *Y, int size, int dimensions) const;
+
+    double estimate(const double *X, const double *pX, const double *Y, int size, int dimensions, HistWorkspace &workspace) const;
+
+    const Histogram *prepare(const double *Y, int size, int dimensions, HistWorkspace &workspace) const;
+
+    double estimate(const double *X, const double *pX, const double *Y, const Histogram *histogram, int size,
+                    HistWorkspace &workspace) const;
+
+    [[nodiscard]] string parameters() const;
 
-    double estimate(const double *X, const double *pX, double *Y, int size, int dimensions);
+    static void linear_bin(double value, pair<double, double> range, int bins, double *grid);
 
 private:
     int histogramDimensions;
-    int *numOfBinsPerDimension;
+    vector<int> numOfBinsPerDimension;
     int totalBins;
     int sumOfBins;
-    pair<double, double> *rangesPerDimension;
+    vector<pair<double, double>> rangesPerDimension;
 
-    Histogram *build_histogram(double *Y, int size, int dimensions);
+    void reserve(HistWorkspace &workspace, int size) const;
 
-    [[nodiscard]] Histogram *initialize_histogram() const;
+    Histogram *build_histogram(const double *Y, int size, int dimensions, HistWorkspace &workspace) const;
 
-    gsl_histogram *build_1d_gsl_histogram(const double *Y, int size);
+    void build_1d_gsl_histogram(const double *Y, int size, gsl_histogram *histogram) const;
 
-    gsl_histogram2d *build_2d_gsl_histogram(const double *Y, int size);
+    void build_2d_gsl_histogram(const double *Y, int size, gsl_histogram2d *histogram) const;
 
-    int *build_nd_histogram(const double *Y, int size);
+    void build_nd_histogram(const double *Y, int size, HistWorkspace &workspace) const;
 
-    int *get_bin_indexes(const double *value);
+    void get_bin_indexes(const double *value, int *bin_indexes) const;
 
     void compute_pdf(Histogram *histogram) const;
 
     static double pdf_entropy(const double *pdf, int size) ;
 
-    double conditional_entropy(const double *X, const double *pX, const double *Y, Histogram *histogram, int size);
+    double conditional_entropy(const double *X, const double *pX, const double *Y, const Histogram *histogram, int size,
+                               HistWorkspace &workspace) const;
 
-    static pair<double*, int> unique(const double *X, int size);
+    static int unique(const double *X, int size, double *unique);
 
 };
 
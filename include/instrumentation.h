@@ -0,0 +1,105 @@
+#ifndef INSTRUMENTATION_H
+#define INSTRUMENTATION_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+using namespace std;
+
+enum class Counter {
+    TREE_BUILDS,
+    KNN_QUERIES,
+    RANGE_QUERIES,
+    NEIGHBOURS_VISITED,
+    HISTOGRAM_FILLS,
+    HDF5_READS,
+    BYTES_RESERVED,  // buffers sized by the library itself, allocations inside mlpack and GSL are not included
+    COUNT
+};
+
+enum class Timer {
+    GKOV_ESTIMATE,
+    HIST_ESTIMATE,
+    TREE_BUILD,
+    KNN_QUERY,
+    RANGE_QUERY,
+    HISTOGRAM_FILL,
+    HDF5_READ,
+    COUNT
+};
+
+class Instrumentation {
+public:
+    static void count(Counter counter, uint64_t amount);
+
+    static void add_time(Timer timer, uint64_t nanoseconds);
+
+    static uint64_t get(Counter counter);
+
+    static uint64_t get(Timer timer);
+
+    static void reset();
+
+    static void write_json(ostream &out);
+
+private:
+    static atomic<uint64_t> counters[(int) Counter::COUNT];
+    static atomic<uint64_t> timers[(int) Timer::COUNT];
+    static atomic<uint64_t> timer_calls[(int) Timer::COUNT];
+
+    static const char *name(Counter counter);
+
+    static const char *name(Timer timer);
+};
+
+class ScopedTimer {
+public:
+    explicit ScopedTimer(Timer timer);
+
+    ~ScopedTimer();
+
+    ScopedTimer(const ScopedTimer &) = delete;
+
+    ScopedTimer &operator=(const ScopedTimer &) = delete;
+
+private:
+    Timer timer;
+    chrono::steady_clock::time_point start;
+};
+
+class ProgressReporter {
+public:
+    ProgressReporter(string label, uint64_t total);
+
+    void update(uint64_t done);
+
+    void finish();
+
+    static void set_enabled(bool enabled);
+
+    static void set_interval(chrono::milliseconds interval);
+
+private:
+    static atomic<bool> enabled;
+    static atomic<int64_t> interval_ms;
+
+    string label;
+    uint64_t total;
+    bool printed;
+    chrono::steady_clock::time_point last;
+};
+
+#ifdef MI_INSTRUMENTATION
+#define MI_CONCAT_(a, b) a##b
+#define MI_CONCAT(a, b) MI_CONCAT_(a, b)
+#define MI_COUNT(counter, amount) Instrumentation::count(Counter::counter, (uint64_t) (amount))
+#define MI_TIME(timer) ScopedTimer MI_CONCAT(mi_timer_, __LINE__)(Timer::timer)
+#else
+#define MI_COUNT(counter, amount) ((void) 0)
+#define MI_TIME(timer) ((void) 0)
+#endif
+
+#endif
@@ -0,0 +1,49 @@
+#ifndef KDE_H
+#define KDE_H
+
+#include <vector>
+#include <utility>
+#include <cmath>
+#include <stdexcept>
+#include <gsl/gsl_fft_complex.h>
+#include "hist.h"
+#include "instrumentation.h"
+#include "aes.h"
+
+using namespace std;
+
+class KDEEstimator {
+public:
+    explicit KDEEstimator(int gridSize = 1024, double bandwidth = 0);
+
+    void fit(const double *pts, const double *Y, int size);
+
+    [[nodiscard]] double estimate(
+            unsigned int key,
+            unsigned int (*crypto_fun)(const unsigned int, const unsigned int),
+            unsigned int (*lkg_fun)(const unsigned int)
+    ) const;
+
+    [[nodiscard]] vector<double> estimate_all(
+            unsigned int (*crypto_fun)(const unsigned int, const unsigned int),
+            unsigned int (*lkg_fun)(const unsigned int)
+    ) const;
+
+    [[nodiscard]] double get_bandwidth() const;
+
+private:
+    int gridSize;
+    double bandwidth;
+    double usedBandwidth;
+    int size;
+    double spacing;
+    vector<double> densities;
+    vector<double> counts;
+    double H_Y;
+
+    void smooth(vector<double> &grids, int numGrids) const;
+
+    [[nodiscard]] double grid_entropy(const double *grid, double count) const;
+};
+
+#endif
@@ -0,0 +1,66 @@
+#ifndef MONITOR_H
+#define MONITOR_H
+
+#include <vector>
+#include <utility>
+#include <cmath>
+#include <cstdint>
+#include <algorithm>
+#include <stdexcept>
+#include "gauss.h"
+
+using namespace std;
+
+enum class MonitorEstimator {
+    BINNED,
+    GAUSSIAN
+};
+
+struct MonitorSnapshot {
+    uint64_t traces;
+    vector<double> scores;
+    unsigned int best_key;
+    double margin;
+};
+
+class OnlineMonitor {
+public:
+    OnlineMonitor(int dimensions, pair<double, double> range, int bins = 32, int sample = 0);
+
+    void update(unsigned int pt, const double *y);
+
+    void update(const double *pts, double **Y, int size);
+
+    void merge(const OnlineMonitor &other);
+
+    void reset();
+
+    [[nodiscard]] uint64_t traces() const;
+
+    [[nodiscard]] MonitorSnapshot query(
+            MonitorEstimator estimator,
+            unsigned int (*crypto_fun)(const unsigned int, const unsigned int),
+            unsigned int (*lkg_fun)(const unsigned int)
+    ) const;
+
+private:
+    int dimensions;
+    int bins;
+    int sample;
+    pair<double, double> range;
+    uint64_t n;
+    vector<uint64_t> counts;
+    GaussEstimator gauss;
+
+    [[nodiscard]] int bin(double value) const;
+
+    [[nodiscard]] double binned_mi(
+            unsigned int key,
+            unsigned int (*crypto_fun)(const unsigned int, const unsigned int),
+            unsigned int (*lkg_fun)(const unsigned int)
+    ) const;
+
+    static MonitorSnapshot summarize(vector<double> scores, uint64_t traces);
+};
+
+#endif
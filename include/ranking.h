@@ -0,0 +1,72 @@
+#ifndef RANKING_H
+#define RANKING_H
+
+#include <functional>
+#include <memory>
+#include <vector>
+#include <cstdint>
+#include <limits>
+#include "gkov.h"
+#include "hist.h"
+#include "aes.h"
+
+using namespace std;
+
+struct KeyScore {
+    unsigned int key;
+    double score;
+    int round;
+};
+
+struct HalvingParameters {
+    uint32_t initial_traces = 64;
+    double keep_fraction = 0.5;
+    int min_candidates = 2;
+    double confidence = 3.0;
+    int patience = 2;
+    int reference_keys = 8;
+    vector<unsigned int> candidates;
+};
+
+struct RankingResult {
+    vector<KeyScore> ranking;
+    uint64_t evaluations;
+    uint64_t evaluated_traces;
+    int rounds;
+    uint32_t traces_used;
+    bool converged;
+};
+
+class KeyRanker {
+public:
+    typedef function<double(double *X, double **Y, int size, int dimensions)> Estimate;
+
+    KeyRanker(
+            Estimate estimate,
+            unsigned int (*crypto_fun)(const unsigned int, const unsigned int),
+            unsigned int (*lkg_fun)(const unsigned int)
+    );
+
+    static Estimate gkov(const GKOVEstimator &estimator);
+
+    static Estimate hist(const HistEstimator &estimator, const double *pX);
+
+    RankingResult rank(const double *pts, double **Y, uint32_t size, int dimensions, const HalvingParameters &parameters) const;
+
+    RankingResult rank_exhaustive(const double *pts, double **Y, uint32_t size, int dimensions) const;
+
+    static RankingResult from_scores(const vector<double> &scores, uint32_t size);
+
+private:
+    Estimate estimate_;
+    unsigned int (*crypto_fun_)(const unsigned int, const unsigned int);
+    unsigned int (*lkg_fun_)(const unsigned int);
+
+    double score(unsigned int key, const double *pts, double **Y, uint32_t size, int dimensions, double *X) const;
+
+    static double noise_floor(const vector<KeyScore> &candidates, const vector<KeyScore> &references);
+
+    static void sort_by_score(vector<KeyScore> &candidates);
+};
+
+#endif
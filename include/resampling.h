@@ -0,0 +1,39 @@
+#ifndef RESAMPLING_H
+#define RESAMPLING_H
+
+#include <vector>
+#include <random>
+#include <cstdint>
+#include <cmath>
+#include "gkov.h"
+#include "hist.h"
+
+using namespace std;
+
+struct ResampledEstimate {
+    double estimate;
+    double ci_low;
+    double ci_high;
+    double p_value;
+};
+
+class Resampler {
+public:
+    Resampler(int size, int bootstraps, int permutations, double confidence, unsigned int seed);
+
+    ResampledEstimate estimate(const GKOVEstimator &estimator, double *X, double **Y, int dimensions) const;
+
+    ResampledEstimate estimate(const HistEstimator &estimator, const double *X, const double *pX, double *Y) const;
+
+private:
+    int size;
+    int subsampleSize;
+    double confidence;
+    vector<vector<int>> bootstrapIndexes;
+    vector<vector<int>> subsampleIndexes;
+    vector<vector<int>> permutationIndexes;
+
+    [[nodiscard]] ResampledEstimate summarize(double estimate, vector<double> &bootstraps, const vector<double> &permutations) const;
+};
+
+#endif
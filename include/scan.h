@@ -0,0 +1,34 @@
+#ifndef SCAN_H
+#define SCAN_H
+
+#include <vector>
+#include <utility>
+#include <cmath>
+#include <algorithm>
+#include <stdexcept>
+#include "instrumentation.h"
+
+using namespace std;
+
+class LeakageScanner {
+public:
+    explicit LeakageScanner(int bins);
+
+    vector<double> scan(const double *X, const double *Y, int size, int samples) const;
+
+    vector<double> scan_windows(const double *X, const double *Y, int size, int samples, int window, int step) const;
+
+    static vector<double> to_column_major(const double *Y, int size, int samples);
+
+    static vector<int> points_of_interest(const vector<double> &mi, int count);
+
+private:
+    int bins;
+
+    static pair<vector<int>, vector<int>> group(const double *X, int size);
+
+    double column_mi(const double *column, int size, const vector<int> &classes, const vector<int> &classSizes,
+                     vector<int> &counts) const;
+};
+
+#endif
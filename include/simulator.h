@@ -2,10 +2,22 @@
 #define SIMULATOR_H
 
 #include <random>
+#include <vector>
+#include <cmath>
 #include <boost/random.hpp>
+#include "aes.h"
 
 using namespace std;
 
+struct AESSimulationConfig {
+    uint32_t samples = AES_KEY_BYTES;
+    vector<uint32_t> leak_positions;
+    string distribution_type = "gauss";
+    double sigma = 1;
+    double correlation = 0;
+    uint32_t block_size = 4096;
+};
+
 class Simulator {
 private:
     mt19937 gen;
@@ -18,6 +30,15 @@ private:
 
     static string write_traces(double *tr_array, double *pt_array, uint32_t n_trc, unsigned int secret_key);
 
+    static vector<uint32_t> leak_positions(const AESSimulationConfig &config);
+
+public:
+    explicit Simulator();
+
+    explicit Simulator(unsigned int seed);
+
+    uint8_t generate_random_byte();
+
     pair<double *, double *> generate_traces_1d(
             uint32_t n_trc,
             unsigned int secret_key,
@@ -27,10 +48,21 @@ private:
             unsigned int (*lkg_fun)(const unsigned int)
     );
 
-public:
-    explicit Simulator();
+    pair<double *, double *> generate_traces_aes(
+            uint32_t n_trc,
+            const uint8_t secret_key[AES_KEY_BYTES],
+            const AESSimulationConfig &config,
+            unsigned int (*crypto_fun)(const unsigned int, const unsigned int),
+            unsigned int (*lkg_fun)(const unsigned int)
+    );
 
-    uint8_t generate_random_byte();
+    string simulate_traces_aes(
+            uint32_t n_trc,
+            const uint8_t secret_key[AES_KEY_BYTES],
+            const AESSimulationConfig &config,
+            unsigned int (*crypto_fun)(const unsigned int, const unsigned int),
+            unsigned int (*lkg_fun)(const unsigned int)
+    );
 
     string simulate_traces_1d(
             uint32_t n_trc,
@@ -5,12 +5,18 @@
 #include <iostream>
 #include <H5Cpp.h>
 #include <cstring>
+#include <vector>
+#include <stdexcept>
+#include "instrumentation.h"
+#include "aes.h"
 
 struct Trace {
     double *traces;
     double *pts;
     hsize_t *dims;
+    hsize_t pts_dims[2];
     unsigned int secret_key;
+    uint8_t key[AES_KEY_BYTES];
 };
 
 class MIUtils {
@@ -25,7 +31,15 @@ public:
     write_traces(const std::string &filename, double *traces, double *pt, const uint32_t size,
                  unsigned int secret_key);
 
-    static std::string generate_filename(uint32_t n_trc);
+    static void
+    write_traces(const std::string &filename, double *traces, double *pts, uint32_t size, uint32_t samples,
+                 const uint8_t key[AES_KEY_BYTES]);
+
+    static void select_byte(Trace &trace, int byte);
+
+    static void select_samples(Trace &trace, const std::vector<int> &samples);
+
+    static std::string generate_filename(uint32_t n_trc, const std::string &suffix = "traces");
 };
 
 #endif
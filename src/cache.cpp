@@ -0,0 +1,145 @@
+#include "../include/cache.h"
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <atomic>
+#include <unistd.h>
+#include <cstdlib>
+
+using namespace std;
+
+/**
+ * Constructor for ResultCache
+ * @param directory - The directory holding the cache entries, created if missing.
+ */
+ResultCache::ResultCache(const string &directory) {
+    this->directory = directory;
+    this->hitCount = 0;
+    this->missCount = 0;
+    filesystem::create_directories(this->directory);
+}
+
+/**
+ * Hashes the content of a trace set: dimensions, traces and plaintexts.
+ * @param trace - The traces as returned by MIUtils::read_traces.
+ * @return The 64-bit hash.
+ */
+uint64_t ResultCache::hash_trace(const Trace &trace) {
+    uint64_t hash = hash_bytes(trace.dims, 2 * sizeof(hsize_t), 0);
+    hash = hash_bytes(trace.traces, trace.dims[0] * trace.dims[1] * sizeof(double), hash);
+    hash = hash_bytes(trace.pts, trace.dims[0] * sizeof(double), hash);
+    return hash;
+}
+
+/**
+ * Builds the key of a cache entry.
+ * @param trace_hash - The hash of the traces.
+ * @param key - The key hypothesis.
+ * @param estimator - The estimator name.
+ * @param parameters - The estimator parameters, e.g. "t=4" or "bins=10;range=[-3,12]".
+ * @return The key.
+ */
+string ResultCache::make_key(uint64_t trace_hash, unsigned int key, const string &estimator, const string &parameters) {
+    stringstream stream;
+    stream << hex << setw(16) << setfill('0') << trace_hash << dec << "|" << key << "|" << estimator << "|" << parameters;
+    return stream.str();
+}
+
+/**
+ * Looks up a cache entry.
+ * @param key - The key.
+ * @param value - Output, the cached estimate if found.
+ * @return True on hit.
+ */
+bool ResultCache::lookup(const string &key, double &value) {
+    ifstream in(entry_path(key));
+    string storedKey;
+    string storedValue;
+    if (in && getline(in, storedKey) && storedKey == key && in >> storedValue) {
+        // strtod, unlike operator>>, parses the nan and inf written for non-finite estimates
+        char *end = nullptr;
+        double parsed = strtod(storedValue.c_str(), &end);
+        if (end != storedValue.c_str() && *end == '\0') {
+            value = parsed;
+            this->hitCount++;
+            return true;
+        }
+    }
+    this->missCount++;
+    return false;
+}
+
+/**
+ * Stores a cache entry. The entry is written to a private temporary file and renamed into place, so that concurrent
+ * processes sharing the directory never read a partial entry. Non-finite estimates are stored as nan or inf.
+ * @param key - The key.
+ * @param value - The estimate.
+ */
+void ResultCache::store(const string &key, double value) const {
+    static atomic<uint64_t> counter(0);
+    auto path = entry_path(key);
+    auto temporary = path;
+    temporary += "." + to_string(getpid()) + "." + to_string(counter++) + ".tmp";
+    {
+        ofstream out(temporary);
+        out << key << "\n" << setprecision(17) << value << "\n";
+        if (!out)
+            throw runtime_error("Could not write cache entry " + temporary.string());
+    }
+    filesystem::rename(temporary, path);
+}
+
+/**
+ * Number of lookups served from the cache.
+ * @return The hit count.
+ */
+uint64_t ResultCache::hits() const {
+    return this->hitCount;
+}
+
+/**
+ * Number of lookups not found in the cache.
+ * @return The miss count.
+ */
+uint64_t ResultCache::misses() const {
+    return this->missCount;
+}
+
+/**
+ * Computes the file holding a cache entry. The full key is stored in the file as well, so hash collisions are
+ * detected on lookup.
+ * @param key - The key.
+ * @return The path of the entry.
+ */
+filesystem::path ResultCache::entry_path(const string &key) const {
+    stringstream name;
+    name << hex << setw(16) << setfill('0') << hash_bytes(key.data(), key.size(), 0) << ".txt";
+    return this->directory / name.str();
+}
+
+/**
+ * FNV-1a hash over 8-byte words with a final avalanche, stable across platforms with the same endianness.
+ * @param data - The bytes.
+ * @param size - The number of bytes.
+ * @param seed - The hash to continue from, 0 to start a new hash.
+ * @return The 64-bit hash.
+ */
+uint64_t ResultCache::hash_bytes(const void *data, size_t size, uint64_t seed) {
+    const uint64_t prime = 0x100000001b3ULL;
+    uint64_t hash = seed ^ 0xcbf29ce484222325ULL;
+    auto *bytes = static_cast<const unsigned char *>(data);
+    size_t i = 0;
+    for (; i + 8 <= size; i += 8) {
+        uint64_t word;
+        memcpy(&word, bytes + i, 8);
+        hash = (hash ^ word) * prime;
+        hash ^= hash >> 32;
+    }
+    for (; i < size; i++)
+        hash = (hash ^ bytes[i]) * prime;
+    hash ^= size;
+    hash ^= hash >> 33;
+    hash *= 0xff51afd7ed558ccdULL;
+    hash ^= hash >> 33;
+    return hash;
+}
@@ -0,0 +1,164 @@
+#include "../include/evaluation.h"
+
+using namespace std;
+
+/**
+ * Constructor for Evaluator
+ * @param t_n - function to compute t_n for the GKOV estimator
+ * @param bins - number of bins of the histogram estimator
+ * @param pX - pdf of the leakage model, used by the histogram estimator
+ * @param crypto_fun - the cryptographic function
+ * @param lkg_fun - the leakage function
+ */
+Evaluator::Evaluator(
+        double (*t_n)(int),
+        int bins,
+        const double *pX,
+        unsigned int (*crypto_fun)(const unsigned int, const unsigned int),
+        unsigned int (*lkg_fun)(const unsigned int)
+) {
+    this->t_n_ = t_n;
+    this->bins_ = bins;
+    this->pX_ = pX;
+    this->crypto_fun_ = crypto_fun;
+    this->lkg_fun_ = lkg_fun;
+}
+
+/**
+ * Runs independent simulate-then-attack experiments in memory and accumulates, for every trace count, the success
+ * rate and the guessing entropy (mean rank of the secret key, 1 being the best) of both estimators.
+ * Each experiment simulates the largest trace count once and attacks its prefixes, experiments run in parallel.
+ * @param trace_counts - the trace counts to attack with, in increasing order
+ * @param repetitions - the number of experiments
+ * @param distribution_type - the noise distribution type
+ * @param sigma - the noise sigma parameter
+ * @param seed - the base seed, experiment r uses seed + r
+ * @return the summary
+ */
+EvaluationSummary Evaluator::evaluate(
+        const vector<uint32_t> &trace_counts,
+        int repetitions,
+        const string &distribution_type,
+        double sigma,
+        unsigned int seed
+) const {
+    if (trace_counts.empty())
+        throw std::invalid_argument("At least one trace count is required.");
+    if (!is_sorted(trace_counts.begin(), trace_counts.end()) || trace_counts[0] == 0)
+        throw std::invalid_argument("Trace counts must be positive and in increasing order.");
+    if (repetitions <= 0)
+        throw std::invalid_argument("Repetitions must be greater than 0.");
+
+    size_t counts = trace_counts.size();
+    vector<double> gkov_hits(counts, 0), gkov_ranks(counts, 0), hist_hits(counts, 0), hist_ranks(counts, 0);
+#pragma omp parallel for schedule(dynamic)
+    for (int r = 0; r < repetitions; r++) {
+        vector<int> gkov_rank(counts), hist_rank(counts);
+        run_experiment(trace_counts.back(), trace_counts, distribution_type, sigma, seed + r, gkov_rank, hist_rank);
+#pragma omp critical
+        for (size_t c = 0; c < counts; c++) {
+            gkov_hits[c] += gkov_rank[c] == 1;
+            gkov_ranks[c] += gkov_rank[c];
+            hist_hits[c] += hist_rank[c] == 1;
+            hist_ranks[c] += hist_rank[c];
+        }
+    }
+
+    EvaluationSummary summary{trace_counts, repetitions};
+    for (size_t c = 0; c < counts; c++) {
+        summary.gkov_success_rate.push_back(gkov_hits[c] / repetitions);
+        summary.gkov_guessing_entropy.push_back(gkov_ranks[c] / repetitions);
+        summary.hist_success_rate.push_back(hist_hits[c] / repetitions);
+        summary.hist_guessing_entropy.push_back(hist_ranks[c] / repetitions);
+    }
+    return summary;
+}
+
+/**
+ * Runs a single experiment: simulates n_trc traces under a random key and ranks all keys on each prefix.
+ * @param n_trc - the number of traces to simulate
+ * @param trace_counts - the prefixes to attack
+ * @param distribution_type - the noise distribution type
+ * @param sigma - the noise sigma parameter
+ * @param seed - the seed of the experiment
+ * @param gkov_ranks - output, rank of the secret key under GKOV for each prefix
+ * @param hist_ranks - output, rank of the secret key under the histogram estimator for each prefix
+ */
+void Evaluator::run_experiment(
+        uint32_t n_trc,
+        const vector<uint32_t> &trace_counts,
+        const string &distribution_type,
+        double sigma,
+        unsigned int seed,
+        vector<int> &gkov_ranks,
+        vector<int> &hist_ranks
+) const {
+    Simulator sim(seed);
+    unsigned int secret_key = sim.generate_random_byte();
+    auto pts_traces = sim.generate_traces_1d(n_trc, secret_key, distribution_type, sigma, this->crypto_fun_, this->lkg_fun_);
+    auto **Y = new double *[n_trc];
+    for (uint32_t i = 0; i < n_trc; i++)
+        Y[i] = pts_traces.second + i;
+
+    auto gkov_estimator = GKOVEstimator(this->t_n_);
+    auto gkov_ranker = KeyRanker(KeyRanker::gkov(gkov_estimator), this->crypto_fun_, this->lkg_fun_);
+    int bins[1] = {this->bins_};
+    for (size_t c = 0; c < trace_counts.size(); c++) {
+        uint32_t n = trace_counts[c];
+        auto range = minmax_element(pts_traces.second, pts_traces.second + n);
+        pair<double, double> ranges[1] = {make_pair(*range.first, *range.second)};
+        auto hist_estimator = HistEstimator(1, bins, ranges);
+        auto hist_ranker = KeyRanker(KeyRanker::hist(hist_estimator, this->pX_), this->crypto_fun_, this->lkg_fun_);
+        gkov_ranks[c] = key_rank(gkov_ranker.rank_exhaustive(pts_traces.first, Y, n, 1), secret_key);
+        hist_ranks[c] = key_rank(hist_ranker.rank_exhaustive(pts_traces.first, Y, n, 1), secret_key);
+    }
+
+    delete[] Y;
+    delete[] pts_traces.first;
+    delete[] pts_traces.second;
+}
+
+/**
+ * Finds the rank of the secret key in a ranking.
+ * @param result - the ranking
+ * @param secret_key - the secret key
+ * @return the rank, 1 being the best
+ */
+int Evaluator::key_rank(const RankingResult &result, unsigned int secret_key) {
+    for (size_t i = 0; i < result.ranking.size(); i++)
+        if (result.ranking[i].key == secret_key)
+            return (int) i + 1;
+    return (int) result.ranking.size();
+}
+
+/**
+ * Writes the summary as JSON.
+ * @param out - the output stream
+ * @param summary - the summary
+ */
+void Evaluator::write_summary(ostream &out, const EvaluationSummary &summary) {
+    out << "{\"repetitions\": " << summary.repetitions << ", \"traces\": [";
+    for (size_t c = 0; c < summary.trace_counts.size(); c++)
+        out << (c ? ", " : "") << summary.trace_counts[c];
+    out << "], \"GKOV\": {\"success_rate\": ";
+    write_array(out, summary.gkov_success_rate);
+    out << ", \"guessing_entropy\": ";
+    write_array(out, summary.gkov_guessing_entropy);
+    out << "}, \"Hist\": {\"success_rate\": ";
+    write_array(out, summary.hist_success_rate);
+    out << ", \"guessing_entropy\": ";
+    write_array(out, summary.hist_guessing_entropy);
+    out << "}}\n";
+}
+
+/**
+ * Writes an array of doubles as JSON.
+ * @param out - the output stream
+ * @param values - the values
+ */
+void Evaluator::write_array(ostream &out, const vector<double> &values) {
+    out << "[";
+    for (size_t i = 0; i < values.size(); i++)
+        out << (i ? ", " : "") << values[i];
+    out << "]";
+}
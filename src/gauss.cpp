@@ -0,0 +1,366 @@
+#include "../include/gauss.h"
+
+using namespace std;
+
+/**
+ * Constructor for GaussianMoments
+ * @param dimensions - The number of dimensions of the samples.
+ */
+GaussianMoments::GaussianMoments(int dimensions) {
+    this->dimensions = dimensions;
+    this->n = 0;
+    this->mu.assign(dimensions, 0);
+    this->m2.assign(dimensions * dimensions, 0);
+    this->delta.assign(dimensions, 0);
+}
+
+/**
+ * Adds a sample with Welford's update of the mean and of the co-moment matrix.
+ * @param y - The sample, dimensions values.
+ */
+void GaussianMoments::add(const double *y) {
+    this->n++;
+    double inverse = 1.0 / (double) this->n;
+    for (int i = 0; i < this->dimensions; i++) {
+        this->delta[i] = y[i] - this->mu[i];
+        this->mu[i] += this->delta[i] * inverse;
+    }
+    for (int i = 0; i < this->dimensions; i++)
+        for (int j = 0; j < this->dimensions; j++)
+            this->m2[i * this->dimensions + j] += this->delta[i] * (y[j] - this->mu[j]);
+}
+
+/**
+ * Merges the moments of another set of samples with Chan's parallel update.
+ * @param other - The moments to merge, with the same number of dimensions.
+ */
+void GaussianMoments::merge(const GaussianMoments &other) {
+    if (other.n == 0)
+        return;
+    if (this->n == 0) {
+        this->n = other.n;
+        this->mu = other.mu;
+        this->m2 = other.m2;
+        return;
+    }
+    double total = (double) (this->n + other.n);
+    double factor = (double) this->n * (double) other.n / total;
+    for (int i = 0; i < this->dimensions; i++)
+        this->delta[i] = other.mu[i] - this->mu[i];
+    for (int i = 0; i < this->dimensions; i++)
+        for (int j = 0; j < this->dimensions; j++)
+            this->m2[i * this->dimensions + j] += other.m2[i * this->dimensions + j] + this->delta[i] * this->delta[j] * factor;
+    for (int i = 0; i < this->dimensions; i++)
+        this->mu[i] += this->delta[i] * (double) other.n / total;
+    this->n += other.n;
+}
+
+/**
+ * Number of samples added.
+ * @return The count.
+ */
+uint64_t GaussianMoments::count() const {
+    return this->n;
+}
+
+/**
+ * Mean of the samples added.
+ * @return The mean.
+ */
+const vector<double> &GaussianMoments::mean() const {
+    return this->mu;
+}
+
+/**
+ * Unbiased covariance of the samples added, row-major.
+ * @return The covariance, zero with less than two samples.
+ */
+vector<double> GaussianMoments::covariance() const {
+    vector<double> covariance(this->m2.size(), 0);
+    if (this->n < 2)
+        return covariance;
+    for (size_t i = 0; i < covariance.size(); i++)
+        covariance[i] = this->m2[i] / (double) (this->n - 1);
+    return covariance;
+}
+
+/**
+ * Constructor for GaussEstimator
+ * The memory is PLAINTEXT_SPACE full covariance matrices, so traces wider than GAUSS_MAX_DIMENSIONS samples are
+ * rejected: select points of interest first, e.g. with LeakageScanner.
+ * @param dimensions - The number of samples per trace, at most GAUSS_MAX_DIMENSIONS.
+ * @param samples - The number of Monte Carlo samples per class used to integrate multivariate mixtures, greater than 0.
+ */
+GaussEstimator::GaussEstimator(int dimensions, int samples) {
+    if (dimensions <= 0)
+        throw std::invalid_argument("Dimensions must be greater than 0.");
+    if (dimensions > GAUSS_MAX_DIMENSIONS)
+        throw std::invalid_argument("Dimensions must be at most " + to_string(GAUSS_MAX_DIMENSIONS) + ", select points of interest first.");
+    if (samples <= 0)
+        throw std::invalid_argument("Samples must be greater than 0.");
+    this->dimensions = dimensions;
+    this->samples = samples;
+    this->moments.assign(PLAINTEXT_SPACE, GaussianMoments(dimensions));
+}
+
+/**
+ * Adds a single trace to the statistics of its plaintext, in O(dimensions^2).
+ * @param pt - The plaintext.
+ * @param y - The trace, dimensions values.
+ */
+void GaussEstimator::add(unsigned int pt, const double *y) {
+    this->moments[pt & 0xFF].add(y);
+}
+
+/**
+ * Accumulates the per-plaintext sufficient statistics of a batch of traces.
+ * The trace indexes are bucketed by plaintext with a counting sort, then plaintexts are split across threads and every
+ * thread updates the shared moments of its own plaintexts, so no thread holds a copy of the moments and the extra
+ * memory is one index per trace.
+ * @param pts - The plaintexts, one byte per trace.
+ * @param Y - The traces, one row per plaintext.
+ * @param size - The number of traces.
+ */
+void GaussEstimator::accumulate(const double *pts, double **Y, int size) {
+    vector<int> offsets(PLAINTEXT_SPACE + 1, 0);
+    for (int i = 0; i < size; i++)
+        offsets[((unsigned int) pts[i] & 0xFF) + 1]++;
+    for (int pt = 0; pt < PLAINTEXT_SPACE; pt++)
+        offsets[pt + 1] += offsets[pt];
+    vector<int> order(size);
+    vector<int> next(offsets.begin(), offsets.end() - 1);
+    for (int i = 0; i < size; i++)
+        order[next[(unsigned int) pts[i] & 0xFF]++] = i;
+#pragma omp parallel for schedule(dynamic)
+    for (int pt = 0; pt < PLAINTEXT_SPACE; pt++)
+        for (int i = offsets[pt]; i < offsets[pt + 1]; i++)
+            this->moments[pt].add(Y[order[i]]);
+}
+
+/**
+ * Merges the statistics accumulated by another estimator, e.g. on another block of traces.
+ * @param other - The estimator to merge, with the same number of dimensions.
+ */
+void GaussEstimator::merge(const GaussEstimator &other) {
+    if (other.dimensions != this->dimensions)
+        throw std::invalid_argument("Dimensions of the estimators must match.");
+    for (int pt = 0; pt < PLAINTEXT_SPACE; pt++)
+        this->moments[pt].merge(other.moments[pt]);
+}
+
+/**
+ * Discards the accumulated statistics.
+ */
+void GaussEstimator::reset() {
+    this->moments.assign(PLAINTEXT_SPACE, GaussianMoments(this->dimensions));
+}
+
+/**
+ * Estimates the MI under a key hypothesis: the per-plaintext statistics are merged into per-class statistics, with
+ * class lkg_fun(crypto_fun(pt, key)), and the MI of the resulting Gaussian mixture is computed.
+ * @param key - The key hypothesis.
+ * @param crypto_fun - The cryptographic function.
+ * @param lkg_fun - The leakage function.
+ * @return The MI in bits.
+ */
+double GaussEstimator::estimate(
+        unsigned int key,
+        unsigned int (*crypto_fun)(const unsigned int, const unsigned int),
+        unsigned int (*lkg_fun)(const unsigned int)
+) const {
+    vector<unsigned int> labels;
+    vector<GaussianMoments> classes;
+    for (unsigned int pt = 0; pt < PLAINTEXT_SPACE; pt++) {
+        unsigned int label = lkg_fun(crypto_fun(pt, key));
+        auto it = find(labels.begin(), labels.end(), label);
+        if (it == labels.end()) {
+            labels.push_back(label);
+            classes.emplace_back(this->dimensions);
+            it = labels.end() - 1;
+        }
+        classes[it - labels.begin()].merge(this->moments[pt]);
+    }
+    return mixture_mi(classes);
+}
+
+/**
+ * Estimates the MI under all the key hypotheses from the same per-plaintext statistics.
+ * @param crypto_fun - The cryptographic function.
+ * @param lkg_fun - The leakage function.
+ * @return The MI in bits, indexed by key.
+ */
+vector<double> GaussEstimator::estimate_all(
+        unsigned int (*crypto_fun)(const unsigned int, const unsigned int),
+        unsigned int (*lkg_fun)(const unsigned int)
+) const {
+    vector<double> mi(PLAINTEXT_SPACE);
+#pragma omp parallel for schedule(dynamic)
+    for (int key = 0; key < PLAINTEXT_SPACE; key++)
+        mi[key] = estimate(key, crypto_fun, lkg_fun);
+    return mi;
+}
+
+/**
+ * Per-plaintext statistics accumulated so far.
+ * @return The moments, indexed by plaintext.
+ */
+const vector<GaussianMoments> &GaussEstimator::plaintext_moments() const {
+    return this->moments;
+}
+
+/**
+ * Computes the MI between the class and Y when Y given the class is Gaussian with the moments of the class.
+ * Classes with too few samples for a full rank covariance use the pooled within-class covariance.
+ * @param classes - The moments of every class.
+ * @return The MI in bits.
+ */
+double GaussEstimator::mixture_mi(const vector<GaussianMoments> &classes) const {
+    int d = this->dimensions;
+    uint64_t total = 0;
+    vector<double> pooled(d * d, 0);
+    for (const auto &moments: classes) {
+        total += moments.count();
+        if (moments.count() > 1) {
+            auto covariance = moments.covariance();
+            for (int i = 0; i < d * d; i++)
+                pooled[i] += covariance[i] * (double) (moments.count() - 1);
+        }
+    }
+    if (total <= classes.size())
+        return 0;
+    for (auto &value: pooled)
+        value /= (double) (total - classes.size());
+
+    vector<GaussianComponent> components;
+    for (const auto &moments: classes) {
+        if (moments.count() == 0)
+            continue;
+        GaussianComponent component{(double) moments.count() / (double) total, moments.mean(),
+                                    moments.count() > (uint64_t) d ? moments.covariance() : pooled, 0};
+        cholesky(component.cholesky, d, component.log_det);
+        if (!isfinite(component.log_det)) {
+            component.cholesky = pooled;
+            cholesky(component.cholesky, d, component.log_det);
+        }
+        if (!isfinite(component.log_det))
+            return 0;
+        components.push_back(component);
+    }
+    return d == 1 ? mixture_mi_1d(components) : mixture_mi_nd(components);
+}
+
+/**
+ * MI of a univariate Gaussian mixture: H(Y) by trapezoidal integration of the mixture density on a grid spanning
+ * every component, H(Y | X) in closed form.
+ * @param components - The components, cholesky holding the standard deviation.
+ * @return The MI in bits.
+ */
+double GaussEstimator::mixture_mi_1d(const vector<GaussianComponent> &components) const {
+    const int grid = 4096;
+    double low = INFINITY, high = -INFINITY, H_Y_given_X = 0;
+    for (const auto &component: components) {
+        low = min(low, component.mean[0] - 10 * component.cholesky[0]);
+        high = max(high, component.mean[0] + 10 * component.cholesky[0]);
+        H_Y_given_X += component.weight * 0.5 * log(2 * M_PI * M_E * component.cholesky[0] * component.cholesky[0]);
+    }
+    double step = (high - low) / (grid - 1);
+    double H_Y = 0;
+    for (int g = 0; g < grid; g++) {
+        double y = low + g * step;
+        double density = 0;
+        for (const auto &component: components) {
+            double z = (y - component.mean[0]) / component.cholesky[0];
+            density += component.weight * exp(-0.5 * z * z) / (component.cholesky[0] * sqrt(2 * M_PI));
+        }
+        if (density > 0)
+            H_Y -= (g == 0 || g == grid - 1 ? 0.5 : 1) * density * log(density) * step;
+    }
+    return (H_Y - H_Y_given_X) / M_LN2;
+}
+
+/**
+ * MI of a multivariate Gaussian mixture, sum_x p(x) E[log f(Y | x) - log f(Y)] by Monte Carlo integration.
+ * The same standard normal draws are used for every call, so estimates under different key hypotheses are compared
+ * with common random numbers.
+ * @param components - The components.
+ * @return The MI in bits.
+ */
+double GaussEstimator::mixture_mi_nd(const vector<GaussianComponent> &components) const {
+    int d = this->dimensions;
+    mt19937 gen(0);
+    normal_distribution<double> normal(0, 1);
+    vector<double> z(d), y(d), scratch(d), logs(components.size());
+    double mi = 0;
+    for (const auto &component: components) {
+        double sum = 0;
+        for (int s = 0; s < this->samples; s++) {
+            for (int i = 0; i < d; i++)
+                z[i] = normal(gen);
+            for (int i = 0; i < d; i++) {
+                y[i] = component.mean[i];
+                for (int j = 0; j <= i; j++)
+                    y[i] += component.cholesky[i * d + j] * z[j];
+            }
+            double largest = -INFINITY;
+            for (size_t c = 0; c < components.size(); c++) {
+                logs[c] = log(components[c].weight) + log_density(components[c], y.data(), scratch.data());
+                largest = max(largest, logs[c]);
+            }
+            double mixture = 0;
+            for (double value: logs)
+                mixture += exp(value - largest);
+            sum += log_density(component, y.data(), scratch.data()) - (largest + log(mixture));
+        }
+        mi += component.weight * sum / this->samples;
+    }
+    return mi / M_LN2;
+}
+
+/**
+ * Log density of a Gaussian component.
+ * @param component - The component.
+ * @param y - The point.
+ * @param scratch - Buffer of dimensions values.
+ * @return The natural log of the density.
+ */
+double GaussEstimator::log_density(const GaussianComponent &component, const double *y, double *scratch) const {
+    int d = this->dimensions;
+    double norm = 0;
+    for (int i = 0; i < d; i++) {
+        double value = y[i] - component.mean[i];
+        for (int j = 0; j < i; j++)
+            value -= component.cholesky[i * d + j] * scratch[j];
+        scratch[i] = value / component.cholesky[i * d + i];
+        norm += scratch[i] * scratch[i];
+    }
+    return -0.5 * (d * log(2 * M_PI) + component.log_det + norm);
+}
+
+/**
+ * In-place Cholesky decomposition of a symmetric matrix into its lower triangular factor.
+ * @param matrix - The row-major matrix, replaced by the factor.
+ * @param dimensions - The size of the matrix.
+ * @param log_det - Output, log determinant of the matrix, infinite if it is not positive definite.
+ */
+void GaussEstimator::cholesky(vector<double> &matrix, int dimensions, double &log_det) {
+    log_det = 0;
+    for (int j = 0; j < dimensions; j++) {
+        double diagonal = matrix[j * dimensions + j];
+        for (int k = 0; k < j; k++)
+            diagonal -= matrix[j * dimensions + k] * matrix[j * dimensions + k];
+        if (diagonal <= 0) {
+            log_det = INFINITY;
+            return;
+        }
+        matrix[j * dimensions + j] = sqrt(diagonal);
+        log_det += log(diagonal);
+        for (int i = j + 1; i < dimensions; i++) {
+            double value = matrix[i * dimensions + j];
+            for (int k = 0; k < j; k++)
+                value -= matrix[i * dimensions + k] * matrix[j * dimensions + k];
+            matrix[i * dimensions + j] = value / matrix[j * dimensions + j];
+        }
+        for (int i = 0; i < j; i++)
+            matrix[i * dimensions + j] = 0;
+    }
+}
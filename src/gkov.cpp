@@ -13,6 +13,20 @@ GKOVEstimator::GKOVEstimator(double (*callback)(int)) {
     t_n_ = callback;
 }
 
+/**
+ * Constructor for GKOVWorkspace, the buffers are allocated by the first estimate that uses it.
+ */
+GKOVWorkspace::GKOVWorkspace() {
+    capacity = 0;
+    rows = 0;
+    xy = nullptr;
+    d_ixy = nullptr;
+    d_i = nullptr;
+    n_ix = nullptr;
+    n_iy = nullptr;
+    a_i = nullptr;
+}
+
 /**
  * Estimate the Mutual Information between X and Y following the method described in https://ia.cr/2022/1201
  * @param X - X values
@@ -21,73 +35,204 @@ GKOVEstimator::GKOVEstimator(double (*callback)(int)) {
  * @param sizeOfY - size of Y
  * @return estimation of Mutual Information between X and Y
  */
-double GKOVEstimator::estimate(double *X, double **Y, int sizeOfX, int sizeOfY[2]) {
-    size_t t = int(t_n(sizeOfX));
+double GKOVEstimator::estimate(double *X, double **Y, int sizeOfX, int sizeOfY[2]) const {
+    GKOVWorkspace workspace;
+    return estimate(X, Y, sizeOfX, sizeOfY, workspace);
+}
+
+/**
+ * Estimate the Mutual Information between X and Y reusing the scratch buffers of a workspace.
+ * Concurrent estimates are safe as long as every thread uses its own workspace.
+ * @param X - X values
+ * @param Y - Y values
+ * @param sizeOfX - size of X
+ * @param sizeOfY - size of Y
+ * @param workspace - the workspace
+ * @return estimation of Mutual Information between X and Y
+ */
+double GKOVEstimator::estimate(double *X, double **Y, int sizeOfX, int sizeOfY[2], GKOVWorkspace &workspace) const {
+    GKOVMarginals marginals = prepare_marginals(X, Y, sizeOfX, sizeOfY);
+    return estimate(X, marginals, workspace);
+}
+
+/**
+ * Builds the search structures of the marginals of X and Y.
+ * Both are invariant under permutations of X: the range counts in X only depend on the multiset of X values, so the
+ * structures can be reused to estimate the Mutual Information between Y and any permutation of X.
+ * @param X - X values
+ * @param Y - Y values
+ * @param sizeOfX - size of X
+ * @param sizeOfY - size of Y
+ * @return the marginals
+ */
+GKOVMarginals GKOVEstimator::prepare_marginals(double *X, double **Y, int sizeOfX, int sizeOfY[2]) {
     mat xy_data = prepare_data(X, Y, sizeOfX, sizeOfY);
     xy_data = xy_data.t();
-    mat x_data = xy_data.submat(0, 0, 0, xy_data.n_cols - 1);
-    mat y_data = xy_data.submat(1, 0, xy_data.n_rows - 1, xy_data.n_cols - 1);
+    GKOVMarginals marginals;
+    marginals.x_data = xy_data.submat(0, 0, 0, xy_data.n_cols - 1);
+    marginals.y_data = xy_data.submat(1, 0, xy_data.n_rows - 1, xy_data.n_cols - 1);
+    marginals.x = prepare_ball_range_search(marginals.x_data);
+    marginals.y = prepare_ball_range_search(marginals.y_data);
+    return marginals;
+}
+
+/**
+ * Builds a view of the marginals that shares their data and search trees without copying them, so that every thread
+ * can query the same trees: range queries only read the reference trees, the per-search state lives in the view.
+ * @param marginals - the marginals returned by prepare_marginals, must outlive the view and not be modified
+ * @return the view
+ */
+GKOVMarginals GKOVEstimator::share_marginals(GKOVMarginals &marginals) {
+    typedef RangeSearch<ChebyshevDistance, mat, BallTree>::Tree Tree;
+    Tree *x_tree = marginals.x.ReferenceTree();
+    Tree *y_tree = marginals.y.ReferenceTree();
+    return GKOVMarginals{
+            mat(marginals.x_data.memptr(), marginals.x_data.n_rows, marginals.x_data.n_cols, false, true),
+            mat(marginals.y_data.memptr(), marginals.y_data.n_rows, marginals.y_data.n_cols, false, true),
+            RangeSearch<ChebyshevDistance, mat, BallTree>(x_tree),
+            RangeSearch<ChebyshevDistance, mat, BallTree>(y_tree)
+    };
+}
+
+/**
+ * Estimate the Mutual Information between X and the Y used to prepare the marginals.
+ * @param X - X values, the X used to prepare the marginals or any permutation of it
+ * @param marginals - the marginals returned by prepare_marginals
+ * @return estimation of Mutual Information between X and Y
+ */
+double GKOVEstimator::estimate(const double *X, GKOVMarginals &marginals) const {
+    GKOVWorkspace workspace;
+    return estimate(X, marginals, workspace);
+}
+
+/**
+ * Estimate the Mutual Information between X and the Y used to prepare the marginals, reusing the scratch buffers of
+ * a workspace. The joint search trees are still built by mlpack on every call.
+ * @param X - X values, the X used to prepare the marginals or any permutation of it
+ * @param marginals - the marginals returned by prepare_marginals
+ * @param workspace - the workspace
+ * @return estimation of Mutual Information between X and Y
+ */
+double GKOVEstimator::estimate(const double *X, GKOVMarginals &marginals, GKOVWorkspace &workspace) const {
+    MI_TIME(GKOV_ESTIMATE);
+    int sizeOfX = (int) marginals.y_data.n_cols;
+    int rows = (int) marginals.y_data.n_rows + 1;
+    size_t t = int(t_n(sizeOfX));
+    reserve(workspace, sizeOfX, rows);
+    for (int i = 0; i < sizeOfX; i++) {
+        workspace.xy[(size_t) i * rows] = X[i];
+        copy(marginals.y_data.colptr(i), marginals.y_data.colptr(i) + rows - 1, workspace.xy + (size_t) i * rows + 1);
+    }
+    mat xy_data(workspace.xy, rows, sizeOfX, false, true);
+    const mat x_data(const_cast<double *>(X), 1, sizeOfX, false, true);
+    const mat &y_data = marginals.y_data;
     auto xy_neighbors = prepare_ball_search(xy_data);
     auto xy_distance = prepare_ball_range_search(xy_data);
-    auto x = prepare_ball_range_search(x_data);
-    auto y = prepare_ball_range_search(y_data);
-
-    Mat<size_t> neighbors;
-    std::vector<std::vector<size_t>> range_neighbors;
-    mat distances;
-    std::vector<std::vector<double>> range_distances;
-    vec d_ixy = zeros(sizeOfX);
-    vec d_i = zeros(sizeOfX);
-    vec n_ix = zeros(sizeOfX);
-    vec n_iy = zeros(sizeOfX);
-    vec a_i = zeros(sizeOfX);
-    for (int i = 0; i < sizeOfX; i++) {
-        xy_neighbors.Search(xy_data.col(i), t + 1, neighbors, distances);
-        d_ixy[i] = distances(t, 0);
+    auto &x = marginals.x;
+    auto &y = marginals.y;
+
+    Mat<size_t> &neighbors = workspace.neighbors;
+    vector<vector<size_t>> &range_neighbors = workspace.range_neighbors;
+    mat &distances = workspace.distances;
+    vector<vector<double>> &range_distances = workspace.range_distances;
+    vec d_ixy(workspace.d_ixy, sizeOfX, false, true);
+    vec d_i(workspace.d_i, sizeOfX, false, true);
+    vec n_ix(workspace.n_ix, sizeOfX, false, true);
+    vec n_iy(workspace.n_iy, sizeOfX, false, true);
+    vec a_i(workspace.a_i, sizeOfX, false, true);
+    d_ixy.zeros();
+    d_i.zeros();
+    n_ix.zeros();
+    n_iy.zeros();
+    a_i.zeros();
+    {
+        MI_TIME(KNN_QUERY);
+        for (int i = 0; i < sizeOfX; i++) {
+            xy_neighbors.Search(xy_data.col(i), t + 1, neighbors, distances);
+            d_ixy[i] = distances(t, 0);
+        }
+        MI_COUNT(KNN_QUERIES, sizeOfX);
     }
-    for (int i = 0; i < sizeOfX; i++) {
-        cout << "Estimating GKOV " << i+1 << "/" << sizeOfX  << "\r";
-        if (d_ixy[i] == 0) {
-            xy_distance.Search(xy_data.col(i), Range(0, 1e-15), range_neighbors, range_distances);
-            d_i[i] = range_neighbors.size();
+    {
+        MI_TIME(RANGE_QUERY);
+        uint64_t range_queries = 0;
+        uint64_t neighbours_visited = 0;
+        ProgressReporter progress("Estimating GKOV", sizeOfX);
+        for (int i = 0; i < sizeOfX; i++) {
+            progress.update(i + 1);
+            if (d_ixy[i] == 0) {
+                xy_distance.Search(xy_data.col(i), Range(0, 1e-15), range_neighbors, range_distances);
+                d_i[i] = range_neighbors.size();
+                range_queries++;
+            }
+            else
+                d_i[i] = t;
+            x.Search(x_data.col(i), Range(0, d_ixy[i]), range_neighbors, range_distances);
+            for(int j = 0; j < range_neighbors.size(); j++)
+                if (range_neighbors[j].size() > 0)
+                    n_ix[i] += range_neighbors[j].size();
+            range_neighbors.clear();
+            range_distances.clear();
+            y.Search(y_data.col(i), Range(0, d_ixy[i]), range_neighbors, range_distances);
+            for(int j = 0; j < range_neighbors.size(); j++)
+                if (range_neighbors[j].size() > 0)
+                    n_iy[i] += range_neighbors[j].size();
+            range_neighbors.clear();
+            range_distances.clear();
+            range_queries += 2;
+            neighbours_visited += (uint64_t) (n_ix[i] + n_iy[i]);
+            a_i[i] = (digamma(d_i[i]) - log(n_ix[i]) - log(n_iy[i]) + log(sizeOfX)) / sizeOfX;
         }
-        else
-            d_i[i] = t;
-        x.Search(x_data.col(i), Range(0, d_ixy[i]), range_neighbors, range_distances);
-        for(int j = 0; j < range_neighbors.size(); j++)
-            if (range_neighbors[j].size() > 0)
-                n_ix[i] += range_neighbors[j].size();
-        range_neighbors.clear();
-        range_distances.clear();
-        y.Search(y_data.col(i), Range(0, d_ixy[i]), range_neighbors, range_distances);
-        for(int j = 0; j < range_neighbors.size(); j++)
-            if (range_neighbors[j].size() > 0)
-                n_iy[i] += range_neighbors[j].size();
-        range_neighbors.clear();
-        range_distances.clear();
-        a_i[i] = (digamma(d_i[i]) - log(n_ix[i]) - log(n_iy[i]) + log(sizeOfX)) / sizeOfX;
+        progress.finish();
+        // Shared counters are only touched once per call, not from the per-point loop
+        MI_COUNT(RANGE_QUERIES, range_queries);
+        MI_COUNT(NEIGHBOURS_VISITED, neighbours_visited);
     }
-    cout << "\n";
-
-    xy_data.clear();
-    x_data.clear();
-    y_data.clear();
-    neighbors.clear();
-    distances.clear();
-    d_ixy.clear();
-    d_i.clear();
-    n_ix.clear();
-    n_iy.clear();
 
     return sum(a_i);
 }
 
+/**
+ * Makes sure the workspace can hold a dataset of the given size, the arena is only released and refilled when the
+ * size or the number of rows grows.
+ * @param workspace - the workspace
+ * @param size - number of points
+ * @param rows - number of rows of the joint data, 1 + dimensions of Y
+ */
+void GKOVEstimator::reserve(GKOVWorkspace &workspace, int size, int rows) {
+    if (size <= workspace.capacity && rows <= workspace.rows)
+        return;
+    int capacity = max(size, workspace.capacity);
+    rows = max(rows, workspace.rows);
+    workspace.arena.release();
+    pmr::polymorphic_allocator<> allocator(&workspace.arena);
+    workspace.xy = allocator.allocate_object<double>((size_t) capacity * rows);
+    workspace.d_ixy = allocator.allocate_object<double>(capacity);
+    workspace.d_i = allocator.allocate_object<double>(capacity);
+    workspace.n_ix = allocator.allocate_object<double>(capacity);
+    workspace.n_iy = allocator.allocate_object<double>(capacity);
+    workspace.a_i = allocator.allocate_object<double>(capacity);
+    MI_COUNT(BYTES_RESERVED, (size_t) capacity * (rows + 5) * sizeof(double));
+    workspace.capacity = capacity;
+    workspace.rows = rows;
+}
+
+/**
+ * Describes the parameters an estimate on size points uses, e.g. to key cached results: they are derived from the
+ * t_n callback, so a change of the callback changes the description.
+ * @param size - length of the dataset
+ * @return the parameters
+ */
+string GKOVEstimator::parameters(int size) const {
+    return "t=" + to_string(int(t_n(size)));
+}
+
 /**
  * Computes the t_n value for the given n.
  * @param n - length of the dataset
  * @return t_n value
  */
-double GKOVEstimator::t_n(int n) {
+double GKOVEstimator::t_n(int n) const {
     return t_n_(n);
 }
 
@@ -127,12 +272,16 @@ void GKOVEstimator::check_dimensions(const int sizeOfX, const int sizeOfY[2]) {
     }
 }
 
-NeighborSearch<NearestNeighborSort, ChebyshevDistance, mat, BallTree> GKOVEstimator::prepare_ball_search(mat data) {
+NeighborSearch<NearestNeighborSort, ChebyshevDistance, mat, BallTree> GKOVEstimator::prepare_ball_search(const mat &data) {
+    MI_TIME(TREE_BUILD);
+    MI_COUNT(TREE_BUILDS, 1);
     NeighborSearch<NearestNeighborSort, ChebyshevDistance, mat, BallTree> search(data);
     return search;
 }
 
-RangeSearch<ChebyshevDistance, mat, BallTree> GKOVEstimator::prepare_ball_range_search(mat data) {
+RangeSearch<ChebyshevDistance, mat, BallTree> GKOVEstimator::prepare_ball_range_search(const mat &data) {
+    MI_TIME(TREE_BUILD);
+    MI_COUNT(TREE_BUILDS, 1);
     RangeSearch<ChebyshevDistance, mat, BallTree> search(data);
     return search;
 }
\ No newline at end of file
@@ -1,135 +1,284 @@
 #include "../include/hist.h"
 
+/**
+ * Constructor for the HistWorkspace class, the buffers are allocated by the first estimate that uses it.
+ * @return An empty HistWorkspace object.
+ */
+HistWorkspace::HistWorkspace() {
+    this->capacity = 0;
+    this->totalBins = 0;
+    this->dimensions = 0;
+    this->bins[0] = 0;
+    this->bins[1] = 0;
+    this->counts = nullptr;
+    this->pdf = nullptr;
+    this->uniqueX = nullptr;
+    this->classEntropy = nullptr;
+    this->values = nullptr;
+    this->binIndexes = nullptr;
+    this->gsl_histogram_1d = nullptr;
+    this->gsl_histogram_2d = nullptr;
+    this->histogram = Histogram{nullptr, nullptr, nullptr, nullptr, 0, 0};
+}
+
+HistWorkspace::~HistWorkspace() {
+    if (this->gsl_histogram_1d != nullptr)
+        gsl_histogram_free(this->gsl_histogram_1d);
+    if (this->gsl_histogram_2d != nullptr)
+        gsl_histogram2d_free(this->gsl_histogram_2d);
+}
+
 /**
  * Constructor for the HistEstimator class.
  * @param dimensions - The number of dimensions of the histogram.
- * @param bins - Array containing the number of bins per dimension.
- * @param ranges - Array of ranges, one for each dimension of the histogram as pair representing min and max.
+ * @param bins - Array containing the number of bins per dimension, copied.
+ * @param ranges - Array of ranges, one for each dimension of the histogram as pair representing min and max, copied.
  * @return A HistEstimator object.
  */
-HistEstimator::HistEstimator(int dimensions, int bins[], pair<double, double> ranges[]) {
+HistEstimator::HistEstimator(int dimensions, const int bins[], const pair<double, double> ranges[]) {
+    if (dimensions <= 0)
+        throw std::invalid_argument("The histogram must have at least one dimension.");
     this->histogramDimensions = dimensions;
-    this->numOfBinsPerDimension = bins;
+    this->numOfBinsPerDimension.assign(bins, bins + dimensions);
     this->totalBins = 1;
     this->sumOfBins = 0;
     for (int i = 0; i < dimensions; i++) {
+        if (this->numOfBinsPerDimension[i] <= 0)
+            throw std::invalid_argument("The number of bins must be greater than 0.");
         this->totalBins *= this->numOfBinsPerDimension[i];
         this->sumOfBins += this->numOfBinsPerDimension[i];
     }
-    this->rangesPerDimension = ranges;
+    this->rangesPerDimension.assign(ranges, ranges + dimensions);
 }
 
 /**
- * Estimates the entropy of the input.
+ * Estimates the entropy of the input with a temporary workspace.
  */
-double HistEstimator::estimate(const double *X, const double *pX, double *Y, int size, int dimensions) {
-    cout << "Estimating entropy with histogram estimator\n";
-    auto histogram = build_histogram(Y, size, dimensions);
-    double H_Y = pdf_entropy(histogram->pdf, this->totalBins);
-    double H_Y_given_X = conditional_entropy(X, pX, Y, histogram, size);
-    return H_Y - H_Y_given_X;
+double HistEstimator::estimate(const double *X, const double *pX, const double *Y, int size, int dimensions) const {
+    HistWorkspace workspace;
+    return estimate(X, pX, Y, size, dimensions, workspace);
 }
 
 /**
- * Builds a histogram and computes its pdf.
- * @param Y - The input.
+ * Estimates the entropy of the input, all scratch memory comes from the workspace so repeated estimates of the same
+ * size do not allocate. Concurrent estimates are safe as long as every thread uses its own workspace.
+ * @param X - The discrete input.
+ * @param pX - The pdf of the discrete input.
+ * @param Y - The continuous input.
+ * @param size - The size of the input.
+ * @param dimensions - The number of dimensions of the input.
+ * @param workspace - The workspace.
+ * @return The estimate.
+ */
+double HistEstimator::estimate(const double *X, const double *pX, const double *Y, int size, int dimensions,
+                               HistWorkspace &workspace) const {
+    auto histogram = prepare(Y, size, dimensions, workspace);
+    return estimate(X, pX, Y, histogram, size, workspace);
+}
+
+/**
+ * Builds the histogram of Y, which only depends on Y and can be reused for any X, e.g. permutations of X.
+ * @param Y - The continuous input.
  * @param size - The size of the input.
  * @param dimensions - The number of dimensions of the input.
+ * @param workspace - The workspace that owns the histogram, it stays valid until the next prepare on it or until an
+ * estimate on it with a larger size, which invalidates it.
  * @return The histogram.
  */
-Histogram *HistEstimator::build_histogram(double *Y, int size, int dimensions) {
-    Histogram *histogram = initialize_histogram();
-    if (dimensions == 1) {
-        histogram->gsl_histogram_1d = build_1d_gsl_histogram(Y, size);
-    } else if (dimensions == 2) {
-        histogram->gsl_histogram_2d = build_2d_gsl_histogram(Y, size);
-    } else {
-        histogram->histogram = build_nd_histogram(Y, size);
+const Histogram *HistEstimator::prepare(const double *Y, int size, int dimensions, HistWorkspace &workspace) const {
+    reserve(workspace, size);
+    return build_histogram(Y, size, dimensions, workspace);
+}
+
+/**
+ * Estimates the entropy of the input from a prepared histogram of Y.
+ * @param X - The discrete input.
+ * @param pX - The pdf of the discrete input.
+ * @param Y - The continuous input used to prepare the histogram.
+ * @param histogram - The histogram returned by prepare.
+ * @param size - The size of the input.
+ * @param workspace - The workspace for the scratch buffers, the one the histogram was prepared in or any other.
+ * @return The estimate.
+ */
+double HistEstimator::estimate(const double *X, const double *pX, const double *Y, const Histogram *histogram, int size,
+                               HistWorkspace &workspace) const {
+    MI_TIME(HIST_ESTIMATE);
+    reserve(workspace, size);
+    if (histogram->pdf == nullptr)
+        throw std::logic_error("The histogram was invalidated by its workspace, prepare must be called again.");
+    double H_Y = pdf_entropy(histogram->pdf, this->totalBins);
+    double H_Y_given_X = conditional_entropy(X, pX, Y, histogram, size, workspace);
+    return H_Y - H_Y_given_X;
+}
+
+/**
+ * Describes the bins and ranges of the estimator exactly, ranges in hexadecimal floating point, e.g. to key cached
+ * results.
+ * @return The parameters.
+ */
+string HistEstimator::parameters() const {
+    stringstream stream;
+    stream << hexfloat;
+    for (int i = 0; i < this->histogramDimensions; i++)
+        stream << (i ? ";" : "") << "bins=" << this->numOfBinsPerDimension[i] << ",range=" << this->rangesPerDimension[i].first
+               << "," << this->rangesPerDimension[i].second;
+    return stream.str();
+}
+
+/**
+ * Adds a value to a grid with linear binning: the unit weight is split between the two nearest grid points,
+ * proportionally to the distance from each of them. Values outside the range are clamped to the first or last point.
+ * @param value - The value.
+ * @param range - The positions of the first and last grid points.
+ * @param bins - The number of grid points.
+ * @param grid - The grid, bins weights.
+ */
+void HistEstimator::linear_bin(double value, pair<double, double> range, int bins, double *grid) {
+    double position = (value - range.first) / (range.second - range.first) * (bins - 1);
+    if (position <= 0) {
+        grid[0] += 1;
+        return;
     }
-    compute_pdf(histogram);
-    return histogram;
+    if (position >= bins - 1) {
+        grid[bins - 1] += 1;
+        return;
+    }
+    int index = (int) position;
+    double fraction = position - index;
+    grid[index] += 1 - fraction;
+    grid[index + 1] += fraction;
+}
+
+/**
+ * Makes sure the workspace can hold an input of the given size for the geometry of this estimator.
+ * The arena is only released and refilled when the size or the geometry grows.
+ * @param workspace - The workspace.
+ * @param size - The size of the input.
+ */
+void HistEstimator::reserve(HistWorkspace &workspace, int size) const {
+    if (size <= workspace.capacity && this->totalBins <= workspace.totalBins && this->histogramDimensions <= workspace.dimensions)
+        return;
+
+    int capacity = max(size, workspace.capacity);
+    int totalBins = max(this->totalBins, workspace.totalBins);
+    int dimensions = max(this->histogramDimensions, workspace.dimensions);
+    // The histogram prepared in this workspace points into the arena, it must be prepared again
+    workspace.histogram.pdf = nullptr;
+    workspace.arena.release();
+    pmr::polymorphic_allocator<> allocator(&workspace.arena);
+    workspace.counts = allocator.allocate_object<int>(totalBins);
+    workspace.pdf = allocator.allocate_object<double>(totalBins);
+    workspace.uniqueX = allocator.allocate_object<double>(capacity);
+    workspace.classEntropy = allocator.allocate_object<double>(capacity);
+    workspace.values = allocator.allocate_object<double>(dimensions);
+    workspace.binIndexes = allocator.allocate_object<int>(dimensions);
+    MI_COUNT(BYTES_RESERVED, totalBins * (sizeof(int) + sizeof(double)) + 2 * capacity * sizeof(double)
+                              + dimensions * (sizeof(double) + sizeof(int)));
+    workspace.capacity = capacity;
+    workspace.totalBins = totalBins;
+    workspace.dimensions = dimensions;
 }
 
 /**
- * Initializes a histogram.
- * @return The initialized but empty histogram.
+ * Builds a histogram and computes its pdf, the GSL histograms of the workspace are only reallocated when the
+ * number of bins changes.
+ * @param Y - The input.
+ * @param size - The size of the input.
+ * @param dimensions - The number of dimensions of the input.
+ * @param workspace - The workspace holding the buffers.
+ * @return The histogram.
  */
-Histogram *HistEstimator::initialize_histogram() const {
-    auto *histogram = new Histogram;
-    if (this->histogramDimensions > 2)
-        histogram->histogram = new int[this->numOfBinsPerDimension[0]];
-    else
-        histogram->histogram = nullptr;
+Histogram *HistEstimator::build_histogram(const double *Y, int size, int dimensions, HistWorkspace &workspace) const {
+    MI_TIME(HISTOGRAM_FILL);
+    Histogram *histogram = &workspace.histogram;
+    histogram->histogram = nullptr;
     histogram->gsl_histogram_1d = nullptr;
     histogram->gsl_histogram_2d = nullptr;
-    histogram->pdf = new double[this->totalBins];
+    histogram->pdf = workspace.pdf;
     histogram->size = this->totalBins;
     histogram->dimensions = this->histogramDimensions;
-    for (int i = 0; i < this->totalBins; i++) {
-        if (this->histogramDimensions > 2)
-            histogram->histogram[i] = 0;
-        histogram->pdf[i] = 0;
+    fill(histogram->pdf, histogram->pdf + this->totalBins, 0.0);
+    int bins0 = this->numOfBinsPerDimension[0];
+    int bins1 = this->histogramDimensions > 1 ? this->numOfBinsPerDimension[1] : 0;
+    if (dimensions == 1 && (workspace.gsl_histogram_1d == nullptr || workspace.bins[0] != bins0)) {
+        if (workspace.gsl_histogram_1d != nullptr)
+            gsl_histogram_free(workspace.gsl_histogram_1d);
+        workspace.gsl_histogram_1d = gsl_histogram_alloc(bins0);
+        workspace.bins[0] = bins0;
+    }
+    if (dimensions == 2 && (workspace.gsl_histogram_2d == nullptr || workspace.bins[0] != bins0 || workspace.bins[1] != bins1)) {
+        if (workspace.gsl_histogram_2d != nullptr)
+            gsl_histogram2d_free(workspace.gsl_histogram_2d);
+        workspace.gsl_histogram_2d = gsl_histogram2d_alloc(bins0, bins1);
+        workspace.bins[0] = bins0;
+        workspace.bins[1] = bins1;
+    }
+    if (dimensions == 1) {
+        build_1d_gsl_histogram(Y, size, workspace.gsl_histogram_1d);
+        histogram->gsl_histogram_1d = workspace.gsl_histogram_1d;
+    } else if (dimensions == 2) {
+        build_2d_gsl_histogram(Y, size, workspace.gsl_histogram_2d);
+        histogram->gsl_histogram_2d = workspace.gsl_histogram_2d;
+    } else {
+        build_nd_histogram(Y, size, workspace);
+        histogram->histogram = workspace.counts;
     }
+    compute_pdf(histogram);
     return histogram;
 }
 
 /**
- * Builds a 1D gsl histogram.
+ * Fills a 1D gsl histogram.
  * @param Y - The input.
  * @param size - The size of the input.
- * @return A pair containing the histogram and the bin centers.
+ * @param histogram - The gsl histogram, its ranges and counts are reset.
  */
-gsl_histogram *HistEstimator::build_1d_gsl_histogram(const double *Y, int size) {
-    auto *histogram = gsl_histogram_alloc(this->numOfBinsPerDimension[0]);
+void HistEstimator::build_1d_gsl_histogram(const double *Y, int size, gsl_histogram *histogram) const {
     gsl_histogram_set_ranges_uniform(histogram, this->rangesPerDimension[0].first, this->rangesPerDimension[0].second);
     for (int i = 0; i < size; i++)
         gsl_histogram_increment(histogram, Y[i]);
-    return histogram;
+    MI_COUNT(HISTOGRAM_FILLS, size);
 }
 
 /**
- * Builds a 2D gsl histogram.
+ * Fills a 2D gsl histogram.
  * @param Y - The input.
  * @param size - The size of the input.
- * @return A pair containing the histogram and the bin centers.
+ * @param histogram - The gsl histogram, its ranges and counts are reset.
  */
-gsl_histogram2d *HistEstimator::build_2d_gsl_histogram(const double *Y, int size) {
-    auto *histogram = gsl_histogram2d_alloc(this->numOfBinsPerDimension[0], this->numOfBinsPerDimension[1]);
+void HistEstimator::build_2d_gsl_histogram(const double *Y, int size, gsl_histogram2d *histogram) const {
     gsl_histogram2d_set_ranges_uniform(histogram, this->rangesPerDimension[0].first, this->rangesPerDimension[0].second, this->rangesPerDimension[1].first, this->rangesPerDimension[1].second);
     for (int i = 0; i < size/2; i++)
         gsl_histogram2d_increment(histogram, Y[i], Y[i + size/2]);
-    return histogram;
+    MI_COUNT(HISTOGRAM_FILLS, size/2);
 }
 
 /**
- * Builds an n-dimensional histogram.
+ * Fills an n-dimensional histogram in the counts of the workspace.
  * @param Y - The input.
  * @param size - The size of the input.
- * @return A pair containing the histogram and the bin centers.
+ * @param workspace - The workspace.
  */
-int *HistEstimator::build_nd_histogram(const double *Y, int size) {
-    auto *histogram = new int[this->totalBins];
+void HistEstimator::build_nd_histogram(const double *Y, int size, HistWorkspace &workspace) const {
+    int *histogram = workspace.counts;
     for (int i = 0; i < this->totalBins; i++)
         histogram[i] = 0;
     for (int i = 0; i < size/this->histogramDimensions; i++) {
-        auto *values = new double[this->histogramDimensions];
         for (int j = 0; j < this->histogramDimensions; j++)
-            values[j] = Y[i + j * size/this->histogramDimensions];
-        int *bin_indexes = get_bin_indexes(values);
+            workspace.values[j] = Y[i + j * size/this->histogramDimensions];
+        get_bin_indexes(workspace.values, workspace.binIndexes);
         for (int j = 0; j < this->histogramDimensions; j++)
-            histogram[bin_indexes[j]]++;
+            histogram[workspace.binIndexes[j]]++;
     }
-    return histogram;
+    MI_COUNT(HISTOGRAM_FILLS, size/this->histogramDimensions);
 }
 
 /**
  * Computes the indexes of the bins of the histogram where the values belong.
  * @param value - The values.
- * @return The indexes of the bins.
+ * @param bin_indexes - Output, the indexes of the bins, one per dimension.
  */
-int *HistEstimator::get_bin_indexes(const double *value) {
-    int size = this->histogramDimensions;
-    auto *bin_indexes = new int[size];
+void HistEstimator::get_bin_indexes(const double *value, int *bin_indexes) const {
     int offset = 0;
     for (int i = 0; i < this->histogramDimensions; i++) {
         double range;
@@ -145,7 +294,6 @@ int *HistEstimator::get_bin_indexes(const double *value) {
             bin_indexes[i] = (int) floor((value[i] - this->rangesPerDimension[i].first) / range) + offset;
         offset += this->numOfBinsPerDimension[i];
     }
-    return bin_indexes;
 }
 
 /**
@@ -191,75 +339,58 @@ double HistEstimator::pdf_entropy(const double *pdf, int size) {
     return -entropy;
 }
 
+
 /**
- * Computes the conditional entropy of the pdf.
+ * Computes the conditional entropy of the pdf in a single pass over the input: every trace is added to the sum of
+ * its class, found by binary search in the unique values of X, so the cost is O(size log |unique X|).
  * @param X - The discrete input.
  * @param pX - The pdf of the discrete input.
  * @param Y - The continuous input.
  * @param histogram - The histogram of the continuous input.
  * @param size - The size of the input.
+ * @param workspace - The workspace.
  * @return The conditional entropy.
  */
-double HistEstimator::conditional_entropy(const double *X, const double *pX, const double *Y, Histogram *histogram, int size) {
-    double entropy = 0;
-    auto uniqueX = unique(X, size);
-    for (int i = 0; i < uniqueX.second; i++) {
-        double stepEntropy = 0;
-        for (int j = 0; j < size; j++) {
-            if (X[j] == uniqueX.first[i]) {
-                auto values = new double[histogram->dimensions];
-                for (int k = 0; k < histogram->dimensions; k++) {
-                    int index = k * size / histogram->dimensions + j;
-                    values[k] = Y[index];
-                }
-                int *bin_indexes = get_bin_indexes(values);
-                int bin_index = 0;
-                int offset = 1;
-                for (int k = 0; k < histogram->dimensions; k++) {
-                    bin_index += bin_indexes[k] * offset;
-                    offset *= this->numOfBinsPerDimension[k];
-                }
-                if (histogram->pdf[bin_index] == 0)
-                    stepEntropy += 0;
-                else
-                    stepEntropy += histogram->pdf[bin_index] * log2(histogram->pdf[bin_index]);
-                delete[] values;
-                delete[] bin_indexes;
-            }
+double HistEstimator::conditional_entropy(const double *X, const double *pX, const double *Y, const Histogram *histogram,
+                                          int size, HistWorkspace &workspace) const {
+    int uniqueSize = unique(X, size, workspace.uniqueX);
+    double *classEntropy = workspace.classEntropy;
+    for (int i = 0; i < uniqueSize; i++)
+        classEntropy[i] = 0;
+    for (int j = 0; j < size; j++) {
+        for (int k = 0; k < histogram->dimensions; k++) {
+            int index = k * size / histogram->dimensions + j;
+            workspace.values[k] = Y[index];
+        }
+        get_bin_indexes(workspace.values, workspace.binIndexes);
+        int bin_index = 0;
+        int offset = 1;
+        for (int k = 0; k < histogram->dimensions; k++) {
+            bin_index += workspace.binIndexes[k] * offset;
+            offset *= this->numOfBinsPerDimension[k];
+        }
+        if (histogram->pdf[bin_index] != 0) {
+            int c = (int) (lower_bound(workspace.uniqueX, workspace.uniqueX + uniqueSize, X[j]) - workspace.uniqueX);
+            classEntropy[c] += histogram->pdf[bin_index] * log2(histogram->pdf[bin_index]);
         }
-        entropy += pX[(int) uniqueX.first[i]] * (-stepEntropy);
     }
-    delete[] uniqueX.first;
+    double entropy = 0;
+    for (int i = 0; i < uniqueSize; i++)
+        entropy += pX[(int) workspace.uniqueX[i]] * (-classEntropy[i]);
     return entropy;
 }
 
 /**
- * Compute a new array containing the unique values of the input array.
+ * Writes the sorted unique values of the input array.
  * @param X - 1D array containing size data points.
  * @param size - The number of data points.
- * @return A pair containing the unique values array and its size.
+ * @param unique - Output, at least size values.
+ * @return The number of unique values.
  */
-pair<double *, int> HistEstimator::unique(const double *X, int size){
-    auto *sorted = new double[size];
-    for (int i = 0; i < size; i++)
-        sorted[i] = X[i];
-    sort(sorted, sorted + size);
-    int uniqueSize = 0;
-    for (int i = 0; i < size; i++)
-        if (i == 0 || sorted[i] != sorted[i - 1])
-            uniqueSize++;
-    auto *unique = new double[uniqueSize];
-    for (int i = 0; i < uniqueSize; i++)
-        unique[i] = 0;
-    unique[0] = sorted[0];
-    int uniqueIndex = 1;
-    for (int i = 1; i < size; i++)
-        if (sorted[i] != sorted[i - 1]) {
-            if (uniqueIndex >= uniqueSize)
-                throw runtime_error("uniqueIndex >= uniqueSize");
-            unique[uniqueIndex] = sorted[i];
-            uniqueIndex++;
-        }
-    delete[] sorted;
-    return make_pair(unique, uniqueSize);
-}
\ No newline at end of file
+int HistEstimator::unique(const double *X, int size, double *unique) {
+    if (size == 0)
+        return 0;
+    copy(X, X + size, unique);
+    sort(unique, unique + size);
+    return (int) (std::unique(unique, unique + size) - unique);
+}
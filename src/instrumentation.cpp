@@ -0,0 +1,185 @@
+#include "../include/instrumentation.h"
+#include <iostream>
+
+using namespace std;
+
+atomic<uint64_t> Instrumentation::counters[(int) Counter::COUNT];
+atomic<uint64_t> Instrumentation::timers[(int) Timer::COUNT];
+atomic<uint64_t> Instrumentation::timer_calls[(int) Timer::COUNT];
+atomic<bool> ProgressReporter::enabled(false);
+atomic<int64_t> ProgressReporter::interval_ms(1000);
+
+/**
+ * Increments a counter.
+ * @param counter - The counter.
+ * @param amount - The increment.
+ */
+void Instrumentation::count(Counter counter, uint64_t amount) {
+    counters[(int) counter].fetch_add(amount, memory_order_relaxed);
+}
+
+/**
+ * Adds a measured interval to a timer.
+ * @param timer - The timer.
+ * @param nanoseconds - The length of the interval.
+ */
+void Instrumentation::add_time(Timer timer, uint64_t nanoseconds) {
+    timers[(int) timer].fetch_add(nanoseconds, memory_order_relaxed);
+    timer_calls[(int) timer].fetch_add(1, memory_order_relaxed);
+}
+
+/**
+ * Reads a counter.
+ * @param counter - The counter.
+ * @return The value of the counter.
+ */
+uint64_t Instrumentation::get(Counter counter) {
+    return counters[(int) counter].load(memory_order_relaxed);
+}
+
+/**
+ * Reads a timer.
+ * @param timer - The timer.
+ * @return The accumulated time in nanoseconds.
+ */
+uint64_t Instrumentation::get(Timer timer) {
+    return timers[(int) timer].load(memory_order_relaxed);
+}
+
+/**
+ * Resets all counters and timers to zero.
+ */
+void Instrumentation::reset() {
+    for (auto &counter: counters)
+        counter.store(0, memory_order_relaxed);
+    for (int i = 0; i < (int) Timer::COUNT; i++) {
+        timers[i].store(0, memory_order_relaxed);
+        timer_calls[i].store(0, memory_order_relaxed);
+    }
+}
+
+/**
+ * Writes all counters and timers as a single JSON object, or only {"enabled": false} when instrumentation is
+ * compiled out.
+ * @param out - The output stream.
+ */
+void Instrumentation::write_json(ostream &out) {
+#ifndef MI_INSTRUMENTATION
+    // Nothing was measured, all-zero counters would read as a measurement
+    out << "{\"enabled\": false}\n";
+#else
+    out << "{\"enabled\": true, \"counters\": {";
+    for (int i = 0; i < (int) Counter::COUNT; i++)
+        out << (i ? ", " : "") << "\"" << name((Counter) i) << "\": " << get((Counter) i);
+    out << "}, \"timers\": {";
+    for (int i = 0; i < (int) Timer::COUNT; i++)
+        out << (i ? ", " : "") << "\"" << name((Timer) i) << "\": {\"seconds\": " << (double) get((Timer) i) / 1e9
+            << ", \"calls\": " << timer_calls[i].load(memory_order_relaxed) << "}";
+    out << "}}\n";
+#endif
+}
+
+/**
+ * Returns the JSON name of a counter.
+ * @param counter - The counter.
+ * @return The name.
+ */
+const char *Instrumentation::name(Counter counter) {
+    switch (counter) {
+        case Counter::TREE_BUILDS: return "tree_builds";
+        case Counter::KNN_QUERIES: return "knn_queries";
+        case Counter::RANGE_QUERIES: return "range_queries";
+        case Counter::NEIGHBOURS_VISITED: return "neighbours_visited";
+        case Counter::HISTOGRAM_FILLS: return "histogram_fills";
+        case Counter::HDF5_READS: return "hdf5_reads";
+        case Counter::BYTES_RESERVED: return "bytes_reserved";
+        default: return "unknown";
+    }
+}
+
+/**
+ * Returns the JSON name of a timer.
+ * @param timer - The timer.
+ * @return The name.
+ */
+const char *Instrumentation::name(Timer timer) {
+    switch (timer) {
+        case Timer::GKOV_ESTIMATE: return "gkov_estimate";
+        case Timer::HIST_ESTIMATE: return "hist_estimate";
+        case Timer::TREE_BUILD: return "tree_build";
+        case Timer::KNN_QUERY: return "knn_query";
+        case Timer::RANGE_QUERY: return "range_query";
+        case Timer::HISTOGRAM_FILL: return "histogram_fill";
+        case Timer::HDF5_READ: return "hdf5_read";
+        default: return "unknown";
+    }
+}
+
+/**
+ * Starts a timer that stops when the object goes out of scope.
+ * @param timer - The timer to accumulate into.
+ */
+ScopedTimer::ScopedTimer(Timer timer) {
+    this->timer = timer;
+    this->start = chrono::steady_clock::now();
+}
+
+ScopedTimer::~ScopedTimer() {
+    auto elapsed = chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - this->start);
+    Instrumentation::add_time(this->timer, elapsed.count());
+}
+
+/**
+ * Constructor for ProgressReporter
+ * @param label - The label printed in front of the progress.
+ * @param total - The total amount of work.
+ */
+ProgressReporter::ProgressReporter(string label, uint64_t total) {
+    this->label = std::move(label);
+    this->total = total;
+    this->printed = false;
+    this->last = chrono::steady_clock::now();
+}
+
+/**
+ * Reports progress to stderr, at most once per interval and only if reporting is enabled.
+ * The clock is only read every 256 updates so the call is cheap inside hot loops.
+ * @param done - The amount of work done so far.
+ */
+void ProgressReporter::update(uint64_t done) {
+    if ((done & 0xFF) != 0 && done != this->total)
+        return;
+    if (!enabled.load(memory_order_relaxed))
+        return;
+    auto now = chrono::steady_clock::now();
+    if (now - this->last < chrono::milliseconds(interval_ms.load(memory_order_relaxed)) && done != this->total)
+        return;
+    this->last = now;
+    this->printed = true;
+    cerr << this->label << " " << done << "/" << this->total << "\r";
+}
+
+/**
+ * Terminates the progress line if anything was printed.
+ */
+void ProgressReporter::finish() {
+    if (this->printed)
+        cerr << "\n";
+    this->printed = false;
+}
+
+/**
+ * Enables or disables progress reporting globally, it is disabled by default.
+ * @param enabled - Whether progress is reported.
+ */
+void ProgressReporter::set_enabled(bool enabled) {
+    ProgressReporter::enabled.store(enabled, memory_order_relaxed);
+}
+
+/**
+ * Sets the minimum interval between two progress reports.
+ * @param interval - The interval.
+ */
+void ProgressReporter::set_interval(chrono::milliseconds interval) {
+    interval_ms.store(interval.count(), memory_order_relaxed);
+}
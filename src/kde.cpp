@@ -0,0 +1,183 @@
+#include "../include/kde.h"
+
+using namespace std;
+
+/**
+ * Constructor for KDEEstimator
+ * @param gridSize - The number of grid points, a power of two.
+ * @param bandwidth - The Gaussian kernel bandwidth, Silverman's rule of thumb on Y if not positive.
+ */
+KDEEstimator::KDEEstimator(int gridSize, double bandwidth) {
+    if (gridSize < 2 || (gridSize & (gridSize - 1)) != 0)
+        throw std::invalid_argument("Grid size must be a power of two greater than 1.");
+    this->gridSize = gridSize;
+    this->bandwidth = bandwidth;
+    this->usedBandwidth = 0;
+    this->size = 0;
+    this->spacing = 0;
+    this->H_Y = 0;
+}
+
+/**
+ * Builds one smoothed density grid per plaintext: Y is linearly binned onto a grid per plaintext and every grid of an
+ * observed plaintext is convolved with the Gaussian kernel through the FFT. Since the convolution is linear, the
+ * marginal density and the class densities of any key hypothesis are sums of these grids and no further FFT is
+ * needed. Cost O(N + 256 G log G), independent of the bandwidth.
+ * @param pts - The plaintexts, one byte per trace.
+ * @param Y - The traces, 1-dimensional.
+ * @param size - The number of traces.
+ */
+void KDEEstimator::fit(const double *pts, const double *Y, int size) {
+    if (size <= 1)
+        throw std::invalid_argument("Size must be greater than 1.");
+    auto range = minmax_element(Y, Y + size);
+    double mean = 0, variance = 0;
+    for (int i = 0; i < size; i++)
+        mean += Y[i];
+    mean /= size;
+    for (int i = 0; i < size; i++)
+        variance += (Y[i] - mean) * (Y[i] - mean);
+    variance /= size - 1;
+    this->usedBandwidth = this->bandwidth > 0 ? this->bandwidth : 1.06 * sqrt(variance) * pow(size, -0.2);
+    if (this->usedBandwidth <= 0)
+        this->usedBandwidth = 1;
+    pair<double, double> gridRange = make_pair(*range.first - 4 * this->usedBandwidth, *range.second + 4 * this->usedBandwidth);
+    this->spacing = (gridRange.second - gridRange.first) / (this->gridSize - 1);
+    this->size = size;
+
+    this->densities.assign((size_t) PLAINTEXT_SPACE * this->gridSize, 0);
+    this->counts.assign(PLAINTEXT_SPACE, 0);
+    MI_COUNT(BYTES_RESERVED, this->densities.size() * sizeof(double));
+    for (int i = 0; i < size; i++) {
+        int pt = (int) pts[i] & 0xFF;
+        HistEstimator::linear_bin(Y[i], gridRange, this->gridSize, this->densities.data() + (size_t) pt * this->gridSize);
+        this->counts[pt]++;
+    }
+    MI_COUNT(HISTOGRAM_FILLS, size);
+    smooth(this->densities, PLAINTEXT_SPACE);
+    vector<double> marginal(this->gridSize, 0);
+    for (int pt = 0; pt < PLAINTEXT_SPACE; pt++) {
+        const double *grid = this->densities.data() + (size_t) pt * this->gridSize;
+        for (int g = 0; g < this->gridSize; g++)
+            marginal[g] += grid[g];
+    }
+    this->H_Y = grid_entropy(marginal.data(), size);
+}
+
+/**
+ * Estimates the MI under a key hypothesis, H(Y) - sum_x p(x) H(Y | X = x), with the class densities obtained by
+ * summing the per-plaintext grids of each class lkg_fun(crypto_fun(pt, key)).
+ * @param key - The key hypothesis.
+ * @param crypto_fun - The cryptographic function.
+ * @param lkg_fun - The leakage function.
+ * @return The MI in bits.
+ */
+double KDEEstimator::estimate(
+        unsigned int key,
+        unsigned int (*crypto_fun)(const unsigned int, const unsigned int),
+        unsigned int (*lkg_fun)(const unsigned int)
+) const {
+    if (this->size == 0)
+        throw std::logic_error("fit must be called before estimate.");
+    vector<unsigned int> labels;
+    vector<double> classCounts;
+    vector<double> classGrids;
+    for (unsigned int pt = 0; pt < PLAINTEXT_SPACE; pt++) {
+        if (this->counts[pt] == 0)
+            continue;
+        unsigned int label = lkg_fun(crypto_fun(pt, key));
+        auto index = (size_t) (find(labels.begin(), labels.end(), label) - labels.begin());
+        if (index == labels.size()) {
+            labels.push_back(label);
+            classCounts.push_back(0);
+            classGrids.resize(classGrids.size() + this->gridSize, 0);
+        }
+        classCounts[index] += this->counts[pt];
+        const double *grid = this->densities.data() + (size_t) pt * this->gridSize;
+        double *classGrid = classGrids.data() + index * this->gridSize;
+        for (int g = 0; g < this->gridSize; g++)
+            classGrid[g] += grid[g];
+    }
+    double H_Y_given_X = 0;
+    for (size_t c = 0; c < labels.size(); c++)
+        H_Y_given_X += classCounts[c] / this->size * grid_entropy(classGrids.data() + c * this->gridSize, classCounts[c]);
+    return this->H_Y - H_Y_given_X;
+}
+
+/**
+ * Estimates the MI under all the key hypotheses from the same per-plaintext grids.
+ * @param crypto_fun - The cryptographic function.
+ * @param lkg_fun - The leakage function.
+ * @return The MI in bits, indexed by key.
+ */
+vector<double> KDEEstimator::estimate_all(
+        unsigned int (*crypto_fun)(const unsigned int, const unsigned int),
+        unsigned int (*lkg_fun)(const unsigned int)
+) const {
+    vector<double> mi(PLAINTEXT_SPACE);
+#pragma omp parallel for schedule(dynamic)
+    for (int key = 0; key < PLAINTEXT_SPACE; key++)
+        mi[key] = estimate(key, crypto_fun, lkg_fun);
+    return mi;
+}
+
+/**
+ * Bandwidth used by the last fit.
+ * @return The bandwidth.
+ */
+double KDEEstimator::get_bandwidth() const {
+    return this->usedBandwidth;
+}
+
+/**
+ * Convolves every grid with the Gaussian kernel: each grid is zero-padded to twice its size to avoid wrap-around,
+ * transformed, multiplied by the characteristic function of the kernel exp(-2 pi^2 h^2 f^2) and transformed back.
+ * Grids of unobserved plaintexts are empty and skipped.
+ * @param grids - numGrids consecutive grids, smoothed in place.
+ * @param numGrids - The number of grids.
+ */
+void KDEEstimator::smooth(vector<double> &grids, int numGrids) const {
+    size_t padded = 2 * (size_t) this->gridSize;
+    vector<double> kernel(padded);
+    for (size_t j = 0; j < padded; j++) {
+        double frequency = (j < padded / 2 ? (double) j : (double) j - (double) padded) / ((double) padded * this->spacing);
+        kernel[j] = exp(-2 * M_PI * M_PI * this->usedBandwidth * this->usedBandwidth * frequency * frequency);
+    }
+#pragma omp parallel
+    {
+        vector<double> data(2 * padded);
+#pragma omp for schedule(static)
+        for (int k = 0; k < numGrids; k++) {
+            if (this->counts[k] == 0)
+                continue;
+            double *grid = grids.data() + (size_t) k * this->gridSize;
+            fill(data.begin(), data.end(), 0);
+            for (int g = 0; g < this->gridSize; g++)
+                data[2 * g] = grid[g];
+            gsl_fft_complex_radix2_forward(data.data(), 1, padded);
+            for (size_t j = 0; j < padded; j++) {
+                data[2 * j] *= kernel[j];
+                data[2 * j + 1] *= kernel[j];
+            }
+            gsl_fft_complex_radix2_inverse(data.data(), 1, padded);
+            for (int g = 0; g < this->gridSize; g++)
+                grid[g] = max(data[2 * g], 0.0);
+        }
+    }
+}
+
+/**
+ * Differential entropy of a smoothed grid, integrated with the rectangle rule.
+ * @param grid - The smoothed grid, weights summing to about count.
+ * @param count - The number of samples binned onto the grid.
+ * @return The entropy in bits.
+ */
+double KDEEstimator::grid_entropy(const double *grid, double count) const {
+    double entropy = 0;
+    for (int g = 0; g < this->gridSize; g++) {
+        double density = grid[g] / (count * this->spacing);
+        if (density > 0)
+            entropy -= density * log2(density) * this->spacing;
+    }
+    return entropy;
+}
@@ -0,0 +1,188 @@
+#include "../include/monitor.h"
+
+using namespace std;
+
+/**
+ * Constructor for OnlineMonitor
+ * The memory is fixed at construction: PLAINTEXT_SPACE x bins counts of one sample and the per-plaintext Gaussian
+ * moments of the whole trace, independently of the number of traces fed.
+ * @param dimensions - The number of samples per trace.
+ * @param range - The range of the binned sample, values outside of it fall in the first or last bin.
+ * @param bins - The number of bins of the binned sample.
+ * @param sample - The index of the binned sample in the trace.
+ */
+OnlineMonitor::OnlineMonitor(int dimensions, pair<double, double> range, int bins, int sample) : gauss(dimensions) {
+    if (bins <= 0)
+        throw std::invalid_argument("The number of bins must be greater than 0.");
+    if (sample < 0 || sample >= dimensions)
+        throw std::invalid_argument("The binned sample must be one of the trace samples.");
+    if (range.second <= range.first)
+        throw std::invalid_argument("The range must not be empty.");
+    this->dimensions = dimensions;
+    this->bins = bins;
+    this->sample = sample;
+    this->range = range;
+    this->n = 0;
+    this->counts.assign((size_t) PLAINTEXT_SPACE * bins, 0);
+}
+
+/**
+ * Feeds a single trace, in O(1) for the counts and O(dimensions^2) for the moments.
+ * @param pt - The plaintext.
+ * @param y - The trace, dimensions values.
+ */
+void OnlineMonitor::update(unsigned int pt, const double *y) {
+    this->counts[(size_t) (pt & 0xFF) * this->bins + bin(y[this->sample])]++;
+    this->gauss.add(pt, y);
+    this->n++;
+}
+
+/**
+ * Feeds a batch of traces.
+ * @param pts - The plaintexts, one byte per trace.
+ * @param Y - The traces, one row per plaintext.
+ * @param size - The number of traces.
+ */
+void OnlineMonitor::update(const double *pts, double **Y, int size) {
+    for (int i = 0; i < size; i++)
+        update((unsigned int) pts[i], Y[i]);
+}
+
+/**
+ * Merges the statistics of another monitor, e.g. one fed by another acquisition thread.
+ * @param other - The monitor to merge, with the same geometry.
+ */
+void OnlineMonitor::merge(const OnlineMonitor &other) {
+    if (other.dimensions != this->dimensions || other.bins != this->bins || other.sample != this->sample
+        || other.range != this->range)
+        throw std::invalid_argument("Geometries of the monitors must match.");
+    for (size_t i = 0; i < this->counts.size(); i++)
+        this->counts[i] += other.counts[i];
+    this->gauss.merge(other.gauss);
+    this->n += other.n;
+}
+
+/**
+ * Discards the statistics accumulated so far.
+ */
+void OnlineMonitor::reset() {
+    fill(this->counts.begin(), this->counts.end(), 0);
+    this->gauss.reset();
+    this->n = 0;
+}
+
+/**
+ * Number of traces fed so far.
+ * @return The count.
+ */
+uint64_t OnlineMonitor::traces() const {
+    return this->n;
+}
+
+/**
+ * Computes the current MI under all the key hypotheses and the margin of the leading one.
+ * The cost only depends on PLAINTEXT_SPACE, the number of bins and the dimensions, not on the number of traces, but
+ * every key is scored from scratch: the binned query is O(256 * 256 * bins), the Gaussian query merges 256 moments of
+ * O(dimensions^2) per key and integrates the mixture, on a 4096-point grid in one dimension or with Monte Carlo
+ * samples and Cholesky factors of O(dimensions^3) above. It is meant to be called once per batch of traces, not per
+ * trace.
+ * @param estimator - The estimator, plug-in on the binned counts or Gaussian mixture on the moments.
+ * @param crypto_fun - The cryptographic function.
+ * @param lkg_fun - The leakage function.
+ * @return The MI in bits indexed by key, the leading key and its margin over the runner-up.
+ */
+MonitorSnapshot OnlineMonitor::query(
+        MonitorEstimator estimator,
+        unsigned int (*crypto_fun)(const unsigned int, const unsigned int),
+        unsigned int (*lkg_fun)(const unsigned int)
+) const {
+    if (estimator == MonitorEstimator::GAUSSIAN)
+        return summarize(this->gauss.estimate_all(crypto_fun, lkg_fun), this->n);
+    vector<double> scores(PLAINTEXT_SPACE);
+#pragma omp parallel for schedule(dynamic)
+    for (int key = 0; key < PLAINTEXT_SPACE; key++)
+        scores[key] = binned_mi(key, crypto_fun, lkg_fun);
+    return summarize(std::move(scores), this->n);
+}
+
+/**
+ * Computes the bin of a value, clamped to the range.
+ * @param value - The value.
+ * @return The bin.
+ */
+int OnlineMonitor::bin(double value) const {
+    double position = (value - this->range.first) / (this->range.second - this->range.first) * this->bins;
+    if (position <= 0)
+        return 0;
+    if (position >= this->bins)
+        return this->bins - 1;
+    return (int) position;
+}
+
+/**
+ * Plug-in MI between the binned sample and the class lkg_fun(crypto_fun(pt, key)), from the per-plaintext counts.
+ * @param key - The key hypothesis.
+ * @param crypto_fun - The cryptographic function.
+ * @param lkg_fun - The leakage function.
+ * @return The MI in bits.
+ */
+double OnlineMonitor::binned_mi(
+        unsigned int key,
+        unsigned int (*crypto_fun)(const unsigned int, const unsigned int),
+        unsigned int (*lkg_fun)(const unsigned int)
+) const {
+    if (this->n == 0)
+        return 0;
+    vector<unsigned int> labels;
+    vector<uint64_t> classCounts;
+    for (unsigned int pt = 0; pt < PLAINTEXT_SPACE; pt++) {
+        unsigned int label = lkg_fun(crypto_fun(pt, key));
+        auto it = find(labels.begin(), labels.end(), label);
+        if (it == labels.end()) {
+            labels.push_back(label);
+            classCounts.resize(classCounts.size() + this->bins, 0);
+            it = labels.end() - 1;
+        }
+        uint64_t *target = classCounts.data() + (it - labels.begin()) * this->bins;
+        const uint64_t *source = this->counts.data() + (size_t) pt * this->bins;
+        for (int b = 0; b < this->bins; b++)
+            target[b] += source[b];
+    }
+
+    vector<double> binTotals(this->bins, 0);
+    for (size_t c = 0; c < labels.size(); c++)
+        for (int b = 0; b < this->bins; b++)
+            binTotals[b] += (double) classCounts[c * this->bins + b];
+    double total = (double) this->n;
+    double mi = 0;
+    for (size_t c = 0; c < labels.size(); c++) {
+        double classTotal = 0;
+        for (int b = 0; b < this->bins; b++)
+            classTotal += (double) classCounts[c * this->bins + b];
+        for (int b = 0; b < this->bins; b++) {
+            double count = (double) classCounts[c * this->bins + b];
+            if (count > 0)
+                mi += count / total * log2(count * total / (classTotal * binTotals[b]));
+        }
+    }
+    return mi;
+}
+
+/**
+ * Finds the leading key and its margin over the runner-up.
+ * @param scores - The MI indexed by key.
+ * @param traces - The number of traces the scores are computed on.
+ * @return The snapshot.
+ */
+MonitorSnapshot OnlineMonitor::summarize(vector<double> scores, uint64_t traces) {
+    unsigned int best = 0;
+    for (unsigned int key = 1; key < scores.size(); key++)
+        if (scores[key] > scores[best])
+            best = key;
+    double runner_up = -INFINITY;
+    for (unsigned int key = 0; key < scores.size(); key++)
+        if (key != best)
+            runner_up = max(runner_up, scores[key]);
+    double margin = scores.size() > 1 ? scores[best] - runner_up : 0;
+    return MonitorSnapshot{traces, std::move(scores), best, margin};
+}
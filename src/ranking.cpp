@@ -0,0 +1,243 @@
+#include "../include/ranking.h"
+
+using namespace std;
+
+/**
+ * Constructor for KeyRanker
+ * @param estimate - MI estimate used to score a key hypothesis
+ * @param crypto_fun - the cryptographic function
+ * @param lkg_fun - the leakage function
+ */
+KeyRanker::KeyRanker(
+        Estimate estimate,
+        unsigned int (*crypto_fun)(const unsigned int, const unsigned int),
+        unsigned int (*lkg_fun)(const unsigned int)
+) {
+    this->estimate_ = std::move(estimate);
+    this->crypto_fun_ = crypto_fun;
+    this->lkg_fun_ = lkg_fun;
+}
+
+/**
+ * Wraps a GKOVEstimator into an Estimate, the Estimate owns a workspace reused by all its calls. Copies of the
+ * Estimate share the workspace, so it is not thread-safe: create one per thread.
+ * @param estimator - The GKOV estimator, must outlive the returned Estimate.
+ * @return The Estimate.
+ */
+KeyRanker::Estimate KeyRanker::gkov(const GKOVEstimator &estimator) {
+    auto workspace = make_shared<GKOVWorkspace>();
+    return [&estimator, workspace](double *X, double **Y, int size, int dimensions) {
+        int sizeOfY[2] = {size, dimensions};
+        return estimator.estimate(X, Y, size, sizeOfY, *workspace);
+    };
+}
+
+/**
+ * Wraps a HistEstimator into an Estimate, the Estimate owns a workspace and a trace buffer reused by all its calls.
+ * Copies of the Estimate share them, so it is not thread-safe: create one per thread.
+ * @param estimator - The histogram estimator, must outlive the returned Estimate.
+ * @param pX - The pdf of the discrete input, must outlive the returned Estimate.
+ * @return The Estimate.
+ */
+KeyRanker::Estimate KeyRanker::hist(const HistEstimator &estimator, const double *pX) {
+    auto workspace = make_shared<HistWorkspace>();
+    auto Y_hist = make_shared<vector<double>>();
+    return [&estimator, pX, workspace, Y_hist](double *X, double **Y, int size, int dimensions) {
+        if (dimensions != 1)
+            throw std::invalid_argument("Histogram ranking supports 1-dimensional traces only.");
+        if ((int) Y_hist->size() < size)
+            Y_hist->resize(size);
+        for (int i = 0; i < size; i++)
+            (*Y_hist)[i] = Y[i][0];
+        return estimator.estimate(X, pX, Y_hist->data(), size, 1, *workspace);
+    };
+}
+
+/**
+ * Ranks all key hypotheses with successive halving: every candidate is scored on a prefix of the traces, the best
+ * keep_fraction of them survive and the prefix is doubled. The search stops once the same key has led for patience
+ * consecutive rounds with a margin over the runner-up of at least confidence times the spread of the wrong keys, or
+ * when all the traces are in use. The spread is recomputed every round on the current prefix, from the trailing
+ * candidates and from up to reference_keys discarded keys that are rescored every round, so it stays available when
+ * few candidates are left; with less than 3 wrong-key scores the search cannot converge. If parameters.candidates is
+ * not empty only those keys are ranked, e.g. the best keys of a cheaper first-pass ranker, and
+ * the references are taken among the other keys.
+ * @param pts - The plaintexts.
+ * @param Y - The traces, one row per plaintext.
+ * @param size - The number of traces.
+ * @param dimensions - The number of samples per trace.
+ * @param parameters - The halving parameters.
+ * @return The ranking, best key first, together with the evaluation counts.
+ */
+RankingResult KeyRanker::rank(const double *pts, double **Y, uint32_t size, int dimensions, const HalvingParameters &parameters) const {
+    if (size == 0)
+        throw std::invalid_argument("Size must be greater than 0.");
+    if (parameters.keep_fraction <= 0 || parameters.keep_fraction > 1)
+        throw std::invalid_argument("Keep fraction must be in (0, 1].");
+
+    RankingResult result{};
+    vector<KeyScore> candidates;
+    vector<KeyScore> eliminated;
+    for (unsigned int key = 0; key < PLAINTEXT_SPACE; key++)
+        if (parameters.candidates.empty() || find(parameters.candidates.begin(), parameters.candidates.end(), key) != parameters.candidates.end())
+            candidates.push_back({key, 0, 0});
+    if (candidates.empty())
+        throw std::invalid_argument("No valid candidate key.");
+    vector<KeyScore> references;
+    if (!parameters.candidates.empty() && parameters.reference_keys > 0) {
+        vector<unsigned int> others;
+        for (unsigned int key = 0; key < PLAINTEXT_SPACE; key++)
+            if (find(parameters.candidates.begin(), parameters.candidates.end(), key) == parameters.candidates.end())
+                others.push_back(key);
+        size_t stride = max(others.size() / (size_t) parameters.reference_keys, (size_t) 1);
+        for (size_t i = 0; i < others.size() && (int) references.size() < parameters.reference_keys; i += stride)
+            references.push_back({others[i], 0, 0});
+    }
+
+    auto *X = new double[size];
+    uint32_t n = min(max(parameters.initial_traces, (uint32_t) 1), size);
+    int leader = -1;
+    int stableRounds = 0;
+    while (true) {
+        for (auto &candidate: candidates) {
+            candidate.score = score(candidate.key, pts, Y, n, dimensions, X);
+            candidate.round = result.rounds;
+        }
+        for (auto &reference: references)
+            reference.score = score(reference.key, pts, Y, n, dimensions, X);
+        result.evaluations += candidates.size() + references.size();
+        result.evaluated_traces += (uint64_t) (candidates.size() + references.size()) * n;
+        result.traces_used = n;
+        result.rounds++;
+        sort_by_score(candidates);
+
+        double noise = noise_floor(candidates, references);
+        double margin = candidates.size() > 1 ? candidates[0].score - candidates[1].score : 0;
+        if ((int) candidates[0].key == leader && margin > 0 && margin >= parameters.confidence * noise)
+            stableRounds++;
+        else
+            stableRounds = 0;
+        leader = (int) candidates[0].key;
+        if (stableRounds >= parameters.patience) {
+            result.converged = true;
+            break;
+        }
+        if (n == size)
+            break;
+
+        auto keep = (size_t) ceil(parameters.keep_fraction * (double) candidates.size());
+        keep = max(keep, (size_t) max(parameters.min_candidates, 1));
+        if (keep < candidates.size()) {
+            eliminated.insert(eliminated.end(), candidates.begin() + (long) keep, candidates.end());
+            for (size_t i = candidates.size(); i > keep && (int) references.size() < parameters.reference_keys; i--)
+                references.push_back({candidates[i - 1].key, 0, 0});
+            candidates.resize(keep);
+        }
+        n = (uint32_t) min((uint64_t) n * 2, (uint64_t) size);
+    }
+    delete[] X;
+
+    result.ranking = candidates;
+    result.ranking.insert(result.ranking.end(), eliminated.begin(), eliminated.end());
+    stable_sort(result.ranking.begin(), result.ranking.end(), [](const KeyScore &a, const KeyScore &b) {
+        if (a.round != b.round)
+            return a.round > b.round;
+        return a.score > b.score;
+    });
+    return result;
+}
+
+/**
+ * Ranks all key hypotheses on the full set of traces.
+ * @param pts - The plaintexts.
+ * @param Y - The traces, one row per plaintext.
+ * @param size - The number of traces.
+ * @param dimensions - The number of samples per trace.
+ * @return The ranking, best key first, together with the evaluation counts.
+ */
+RankingResult KeyRanker::rank_exhaustive(const double *pts, double **Y, uint32_t size, int dimensions) const {
+    if (size == 0)
+        throw std::invalid_argument("Size must be greater than 0.");
+    RankingResult result{};
+    auto *X = new double[size];
+    for (unsigned int key = 0; key < PLAINTEXT_SPACE; key++)
+        result.ranking.push_back({key, score(key, pts, Y, size, dimensions, X), 0});
+    delete[] X;
+    sort_by_score(result.ranking);
+    result.evaluations = PLAINTEXT_SPACE;
+    result.evaluated_traces = (uint64_t) PLAINTEXT_SPACE * size;
+    result.rounds = 1;
+    result.traces_used = size;
+    result.converged = true;
+    return result;
+}
+
+/**
+ * Builds the ranking of an estimator that scores all key hypotheses in a single pass over the traces.
+ * @param scores - The score of every key, indexed by key.
+ * @param size - The number of traces.
+ * @return The ranking, best key first.
+ */
+RankingResult KeyRanker::from_scores(const vector<double> &scores, uint32_t size) {
+    RankingResult result{};
+    for (unsigned int key = 0; key < scores.size(); key++)
+        result.ranking.push_back({key, scores[key], 0});
+    sort_by_score(result.ranking);
+    result.evaluations = scores.size();
+    result.evaluated_traces = size;
+    result.rounds = 1;
+    result.traces_used = size;
+    result.converged = true;
+    return result;
+}
+
+/**
+ * Scores a key hypothesis on the first size traces.
+ * @param key - The key hypothesis.
+ * @param pts - The plaintexts.
+ * @param Y - The traces, one row per plaintext.
+ * @param size - The number of traces to use.
+ * @param dimensions - The number of samples per trace.
+ * @param X - Scratch buffer of at least size elements for the hypothetical leakages.
+ * @return The MI estimate.
+ */
+double KeyRanker::score(unsigned int key, const double *pts, double **Y, uint32_t size, int dimensions, double *X) const {
+    for (uint32_t i = 0; i < size; i++)
+        X[i] = this->lkg_fun_(this->crypto_fun_((unsigned int) pts[i], key));
+    return this->estimate_(X, Y, (int) size, dimensions);
+}
+
+/**
+ * Computes the standard deviation of the wrong-key scores of the current round: all but the leading candidate and
+ * the references.
+ * @param candidates - The candidates, sorted by descending score.
+ * @param references - The reference keys, scored on the same traces.
+ * @return The standard deviation, infinite with less than 3 wrong-key scores.
+ */
+double KeyRanker::noise_floor(const vector<KeyScore> &candidates, const vector<KeyScore> &references) {
+    vector<double> scores;
+    for (size_t i = 1; i < candidates.size(); i++)
+        scores.push_back(candidates[i].score);
+    for (const auto &reference: references)
+        scores.push_back(reference.score);
+    if (scores.size() < 3)
+        return numeric_limits<double>::infinity();
+    double mean = 0;
+    for (double score: scores)
+        mean += score;
+    mean /= (double) scores.size();
+    double variance = 0;
+    for (double score: scores)
+        variance += (score - mean) * (score - mean);
+    return sqrt(variance / (double) (scores.size() - 1));
+}
+
+/**
+ * Sorts the candidates by descending score.
+ * @param candidates - The candidates.
+ */
+void KeyRanker::sort_by_score(vector<KeyScore> &candidates) {
+    stable_sort(candidates.begin(), candidates.end(), [](const KeyScore &a, const KeyScore &b) {
+        return a.score > b.score;
+    });
+}
@@ -0,0 +1,174 @@
+#include "../include/resampling.h"
+
+using namespace std;
+
+/**
+ * Constructor for Resampler
+ * The bootstrap, subsample and permutation indexes are drawn once here and shared by every estimate, so that all the
+ * key hypotheses evaluated on the same traces are resampled in the same way. Subsamples are drawn without replacement
+ * and have size^(2/3) traces.
+ * @param size - The number of traces.
+ * @param bootstraps - The number of bootstrap resamples of the histogram estimate and of subsamples of the GKOV
+ * estimate.
+ * @param permutations - The number of permutations of X for the significance test.
+ * @param confidence - The confidence level of the interval, e.g. 0.95.
+ * @param seed - The seed of the resampling.
+ */
+Resampler::Resampler(int size, int bootstraps, int permutations, double confidence, unsigned int seed) {
+    if (size <= 0)
+        throw std::invalid_argument("Size must be greater than 0.");
+    if (bootstraps < 0 || permutations < 0)
+        throw std::invalid_argument("Number of resamples must not be negative.");
+    if (confidence <= 0 || confidence >= 1)
+        throw std::invalid_argument("Confidence must be in (0, 1).");
+    this->size = size;
+    this->confidence = confidence;
+    mt19937 gen(seed);
+    uniform_int_distribution<int> index(0, size - 1);
+    this->bootstrapIndexes.resize(bootstraps, vector<int>(size));
+    for (auto &indexes: this->bootstrapIndexes)
+        for (auto &i: indexes)
+            i = index(gen);
+    this->permutationIndexes.resize(permutations, vector<int>(size));
+    for (auto &indexes: this->permutationIndexes) {
+        for (int i = 0; i < size; i++)
+            indexes[i] = i;
+        shuffle(indexes.begin(), indexes.end(), gen);
+    }
+    this->subsampleSize = (int) pow((double) size, 2.0 / 3);
+    if (this->subsampleSize >= 2 && this->subsampleSize < size) {
+        vector<int> all(size);
+        this->subsampleIndexes.resize(bootstraps);
+        for (auto &indexes: this->subsampleIndexes) {
+            for (int i = 0; i < size; i++)
+                all[i] = i;
+            shuffle(all.begin(), all.end(), gen);
+            indexes.assign(all.begin(), all.begin() + this->subsampleSize);
+        }
+    }
+}
+
+/**
+ * GKOV estimate with an m-out-of-n subsampling confidence interval and a permutation p-value. The bootstrap is not
+ * applied: resampling with replacement duplicates points, which gives zero kNN distances and biases the estimator.
+ * Subsamples of m = n^(2/3) distinct traces are used instead, assuming a sqrt(n) rate: the quantiles of
+ * sqrt(m) (estimate_m - estimate) give the interval of the estimate on n traces. The interval is NaN when there are
+ * no subsamples.
+ * Permutations only rebuild the joint search structures: the marginal trees are built once and shared read-only by
+ * all the threads.
+ * @param estimator - The GKOV estimator.
+ * @param X - X values.
+ * @param Y - Y values, one row per trace.
+ * @param dimensions - The number of columns of Y.
+ * @return The estimate, its confidence interval and p-value.
+ */
+ResampledEstimate Resampler::estimate(const GKOVEstimator &estimator, double *X, double **Y, int dimensions) const {
+    int sizeOfY[2] = {this->size, dimensions};
+    auto marginals = GKOVEstimator::prepare_marginals(X, Y, this->size, sizeOfY);
+    GKOVWorkspace workspace;
+    double estimate = estimator.estimate(X, marginals, workspace);
+
+    // Subsample estimates are rescaled so that their percentiles are the subsampling interval
+    vector<double> subsamples(this->subsampleIndexes.size());
+    double scale = sqrt((double) this->subsampleSize / (double) this->size);
+#pragma omp parallel
+    {
+        GKOVWorkspace local_workspace;
+        vector<double> X_s(this->subsampleSize);
+        vector<double *> Y_s(this->subsampleSize);
+        int sizeOfY_s[2] = {this->subsampleSize, dimensions};
+#pragma omp for schedule(dynamic)
+        for (size_t b = 0; b < this->subsampleIndexes.size(); b++) {
+            for (int i = 0; i < this->subsampleSize; i++) {
+                X_s[i] = X[this->subsampleIndexes[b][i]];
+                Y_s[i] = Y[this->subsampleIndexes[b][i]];
+            }
+            double subsample = estimator.estimate(X_s.data(), Y_s.data(), this->subsampleSize, sizeOfY_s, local_workspace);
+            subsamples[b] = estimate - scale * (subsample - estimate);
+        }
+    }
+
+    vector<double> permutations(this->permutationIndexes.size());
+#pragma omp parallel
+    {
+        GKOVMarginals local = GKOVEstimator::share_marginals(marginals);
+        GKOVWorkspace local_workspace;
+        vector<double> X_p(this->size);
+#pragma omp for schedule(dynamic)
+        for (size_t p = 0; p < this->permutationIndexes.size(); p++) {
+            for (int i = 0; i < this->size; i++)
+                X_p[i] = X[this->permutationIndexes[p][i]];
+            permutations[p] = estimator.estimate(X_p.data(), local, local_workspace);
+        }
+    }
+    return summarize(estimate, subsamples, permutations);
+}
+
+/**
+ * Histogram estimate with a bootstrap confidence interval and a permutation p-value.
+ * Permutations reuse the histogram of Y, which is built once, each thread estimates in its own workspace.
+ * @param estimator - The histogram estimator, 1-dimensional.
+ * @param X - The discrete input.
+ * @param pX - The pdf of the discrete input.
+ * @param Y - The continuous input.
+ * @return The estimate, its confidence interval and p-value.
+ */
+ResampledEstimate Resampler::estimate(const HistEstimator &estimator, const double *X, const double *pX, double *Y) const {
+    HistWorkspace workspace;
+    auto histogram = estimator.prepare(Y, this->size, 1, workspace);
+    double estimate = estimator.estimate(X, pX, Y, histogram, this->size, workspace);
+
+    vector<double> bootstraps(this->bootstrapIndexes.size());
+#pragma omp parallel
+    {
+        HistWorkspace local;
+        vector<double> X_b(this->size);
+        vector<double> Y_b(this->size);
+#pragma omp for schedule(dynamic)
+        for (size_t b = 0; b < this->bootstrapIndexes.size(); b++) {
+            for (int i = 0; i < this->size; i++) {
+                X_b[i] = X[this->bootstrapIndexes[b][i]];
+                Y_b[i] = Y[this->bootstrapIndexes[b][i]];
+            }
+            bootstraps[b] = estimator.estimate(X_b.data(), pX, Y_b.data(), this->size, 1, local);
+        }
+    }
+
+    vector<double> permutations(this->permutationIndexes.size());
+#pragma omp parallel
+    {
+        HistWorkspace local;
+        vector<double> X_p(this->size);
+#pragma omp for schedule(dynamic)
+        for (size_t p = 0; p < this->permutationIndexes.size(); p++) {
+            for (int i = 0; i < this->size; i++)
+                X_p[i] = X[this->permutationIndexes[p][i]];
+            permutations[p] = estimator.estimate(X_p.data(), pX, Y, histogram, this->size, local);
+        }
+    }
+    return summarize(estimate, bootstraps, permutations);
+}
+
+/**
+ * Computes the percentile bootstrap interval and the permutation p-value, (1 + #{permuted >= estimate}) / (1 + P).
+ * @param estimate - The estimate on the original data.
+ * @param bootstraps - The bootstrap estimates, sorted in place.
+ * @param permutations - The estimates under permutations of X.
+ * @return The summary, the interval is NaN without bootstraps and the p-value is 1 without permutations.
+ */
+ResampledEstimate Resampler::summarize(double estimate, vector<double> &bootstraps, const vector<double> &permutations) const {
+    ResampledEstimate result{estimate, NAN, NAN, 1};
+    if (!bootstraps.empty()) {
+        sort(bootstraps.begin(), bootstraps.end());
+        double alpha = (1 - this->confidence) / 2;
+        auto last = (double) (bootstraps.size() - 1);
+        result.ci_low = bootstraps[(size_t) floor(alpha * last)];
+        result.ci_high = bootstraps[(size_t) ceil((1 - alpha) * last)];
+    }
+    int exceed = 0;
+    for (double permuted: permutations)
+        if (permuted >= estimate)
+            exceed++;
+    result.p_value = (1.0 + exceed) / (1.0 + (double) permutations.size());
+    return result;
+}
@@ -0,0 +1,174 @@
+#include "../include/scan.h"
+
+using namespace std;
+
+/**
+ * Constructor for LeakageScanner
+ * @param bins - The number of histogram bins per time sample.
+ */
+LeakageScanner::LeakageScanner(int bins) {
+    if (bins <= 0)
+        throw std::invalid_argument("Number of bins must be greater than 0.");
+    this->bins = bins;
+}
+
+/**
+ * Estimates MI(X; Y[:, j]) for every time sample j with a histogram estimator in a single sweep.
+ * Y is transposed once so that every column is contiguous, X is grouped once and the grouping is shared by all
+ * columns, columns are processed in parallel.
+ * @param X - The discrete input, one value per trace.
+ * @param Y - The traces, row-major size x samples.
+ * @param size - The number of traces.
+ * @param samples - The number of time samples per trace.
+ * @return The MI, in bits, for every time sample.
+ */
+vector<double> LeakageScanner::scan(const double *X, const double *Y, int size, int samples) const {
+    return scan_windows(X, Y, size, samples, 1, 1);
+}
+
+/**
+ * Estimates MI between X and the mean of Y over sliding windows of samples, for windows starting every step samples.
+ * With window = step = 1 this is the per-sample scan.
+ * @param X - The discrete input, one value per trace.
+ * @param Y - The traces, row-major size x samples.
+ * @param size - The number of traces.
+ * @param samples - The number of time samples per trace.
+ * @param window - The number of samples averaged in a window.
+ * @param step - The distance between the first samples of two consecutive windows.
+ * @return The MI, in bits, for every window.
+ */
+vector<double> LeakageScanner::scan_windows(const double *X, const double *Y, int size, int samples, int window, int step) const {
+    if (size <= 0 || samples <= 0)
+        throw std::invalid_argument("Sizes of Y must be greater than 0.");
+    if (window <= 0 || window > samples || step <= 0)
+        throw std::invalid_argument("Window must be in [1, samples] and step greater than 0.");
+
+    auto columns = to_column_major(Y, size, samples);
+    auto grouping = group(X, size);
+    int windows = (samples - window) / step + 1;
+    vector<double> mi(windows);
+#pragma omp parallel
+    {
+        vector<int> counts;
+        vector<double> averaged(window > 1 ? size : 0);
+#pragma omp for schedule(static)
+        for (int w = 0; w < windows; w++) {
+            const double *column = columns.data() + (size_t) w * step * size;
+            if (window > 1) {
+                fill(averaged.begin(), averaged.end(), 0);
+                for (int k = 0; k < window; k++)
+                    for (int i = 0; i < size; i++)
+                        averaged[i] += column[(size_t) k * size + i];
+                for (int i = 0; i < size; i++)
+                    averaged[i] /= window;
+                column = averaged.data();
+            }
+            mi[w] = column_mi(column, size, grouping.first, grouping.second, counts);
+        }
+    }
+    return mi;
+}
+
+/**
+ * Transposes row-major traces into column-major order, in tiles to stay cache friendly.
+ * @param Y - The traces, row-major size x samples.
+ * @param size - The number of traces.
+ * @param samples - The number of time samples per trace.
+ * @return The traces, column-major: sample j of trace i is at j * size + i.
+ */
+vector<double> LeakageScanner::to_column_major(const double *Y, int size, int samples) {
+    const int tile = 64;
+    vector<double> columns((size_t) size * samples);
+    MI_COUNT(BYTES_RESERVED, columns.size() * sizeof(double));
+    for (int i0 = 0; i0 < size; i0 += tile)
+        for (int j0 = 0; j0 < samples; j0 += tile)
+            for (int i = i0; i < min(i0 + tile, size); i++)
+                for (int j = j0; j < min(j0 + tile, samples); j++)
+                    columns[(size_t) j * size + i] = Y[(size_t) i * samples + j];
+    return columns;
+}
+
+/**
+ * Selects the samples, or windows, with the highest MI.
+ * @param mi - The MI curve.
+ * @param count - The number of points of interest to select.
+ * @return Their indexes, by decreasing MI.
+ */
+vector<int> LeakageScanner::points_of_interest(const vector<double> &mi, int count) {
+    vector<int> indexes(mi.size());
+    for (int i = 0; i < (int) mi.size(); i++)
+        indexes[i] = i;
+    count = min(count, (int) mi.size());
+    partial_sort(indexes.begin(), indexes.begin() + count, indexes.end(), [&mi](int a, int b) {
+        return mi[a] > mi[b];
+    });
+    indexes.resize(count);
+    return indexes;
+}
+
+/**
+ * Maps every value of X to a dense class index.
+ * @param X - The discrete input.
+ * @param size - The number of values.
+ * @return The class of every value and the number of values in every class.
+ */
+pair<vector<int>, vector<int>> LeakageScanner::group(const double *X, int size) {
+    vector<double> values(X, X + size);
+    sort(values.begin(), values.end());
+    values.erase(std::unique(values.begin(), values.end()), values.end());
+    vector<int> classes(size);
+    vector<int> classSizes(values.size(), 0);
+    for (int i = 0; i < size; i++) {
+        classes[i] = (int) (lower_bound(values.begin(), values.end(), X[i]) - values.begin());
+        classSizes[classes[i]]++;
+    }
+    return make_pair(classes, classSizes);
+}
+
+/**
+ * Plug-in histogram estimate of MI between the classes and one column, H(Y) - sum_x p(x) H(Y | X = x), with bins
+ * spanning the range of the column.
+ * @param column - The column, contiguous.
+ * @param size - The number of traces.
+ * @param classes - The class of every trace.
+ * @param classSizes - The number of traces in every class.
+ * @param counts - Scratch buffer reused across columns.
+ * @return The MI in bits.
+ */
+double LeakageScanner::column_mi(const double *column, int size, const vector<int> &classes, const vector<int> &classSizes,
+                                 vector<int> &counts) const {
+    auto range = minmax_element(column, column + size);
+    double low = *range.first;
+    double width = (*range.second - low) / this->bins;
+    if (width <= 0)
+        return 0;
+    size_t numClasses = classSizes.size();
+    counts.assign((numClasses + 1) * this->bins, 0);
+    int *marginal = counts.data() + numClasses * this->bins;
+    for (int i = 0; i < size; i++) {
+        int bin = min((int) ((column[i] - low) / width), this->bins - 1);
+        counts[(size_t) classes[i] * this->bins + bin]++;
+        marginal[bin]++;
+    }
+    MI_COUNT(HISTOGRAM_FILLS, size);
+
+    double H_Y = 0;
+    for (int b = 0; b < this->bins; b++)
+        if (marginal[b] > 0) {
+            double p = (double) marginal[b] / size;
+            H_Y -= p * log2(p);
+        }
+    double H_Y_given_X = 0;
+    for (size_t c = 0; c < numClasses; c++) {
+        double entropy = 0;
+        for (int b = 0; b < this->bins; b++) {
+            int count = counts[c * this->bins + b];
+            if (count > 0) {
+                double p = (double) count / classSizes[c];
+                entropy -= p * log2(p);
+            }
+        }
+        H_Y_given_X += (double) classSizes[c] / size * entropy;
+    }
+    return H_Y - H_Y_given_X;
+}
@@ -14,6 +14,21 @@ Simulator::Simulator() {
     this->dist = uniform_int_distribution<int>(0, ub);
 }
 
+/**
+ * Simulator class constructor with a fixed seed
+ * Initializes the state variables so that independent simulators can be run reproducibly in parallel. Both engines
+ * are seeded through a seed_seq: default_random_engine seeded directly maps seeds 0 and 1 to the same state.
+ * @param seed the seed of the random engines
+ */
+Simulator::Simulator(unsigned int seed) {
+    seed_seq pt_sequence{seed, 0U};
+    seed_seq noise_sequence{seed, 1U};
+    this->gen = mt19937(pt_sequence);
+    this->generator = default_random_engine(noise_sequence);
+    this->ub = (1UL << 20) - 1;
+    this->dist = uniform_int_distribution<int>(0, ub);
+}
+
 /**
  * Generates a random byte using the uniform distribution
  * @return a random byte
@@ -60,7 +75,7 @@ string Simulator::write_traces(double *tr_array, double *pt_array, uint32_t n_tr
  * @param sigma the sigma parameter
  * @param crypto_fun the cryptographic function
  * @param lkg_fun the leakage function
- * @return the traces
+ * @return the plaintexts and the traces, owned by the caller
  */
 pair<double *, double *> Simulator::generate_traces_1d(
         const uint32_t n_trc,
@@ -104,4 +119,108 @@ string Simulator::simulate_traces_1d(
 ) {
     pair<double*, double*> pts_traces = this->generate_traces_1d(n_trc, secret_key, distribution_type, sigma, crypto_fun, lkg_fun);
     return this->write_traces(pts_traces.second, pts_traces.first, n_trc, secret_key);
-}
\ No newline at end of file
+}
+
+/**
+ * Checks the configuration and returns the sample where each key byte leaks, by default byte b leaks at sample b
+ * @param config the simulation configuration
+ * @return the leak positions, one per key byte
+ * @throws invalid_argument if the configuration is invalid
+ */
+vector<uint32_t> Simulator::leak_positions(const AESSimulationConfig &config) {
+    if (config.block_size == 0)
+        throw std::invalid_argument("Block size must be greater than 0.");
+    if (config.correlation <= -1 || config.correlation >= 1)
+        throw std::invalid_argument("Noise correlation must be in (-1, 1).");
+    vector<uint32_t> positions = config.leak_positions;
+    if (positions.empty())
+        for (uint32_t b = 0; b < AES_KEY_BYTES; b++)
+            positions.push_back(b);
+    if (positions.size() != AES_KEY_BYTES)
+        throw std::invalid_argument("One leak position per key byte is required.");
+    for (uint32_t position: positions)
+        if (position >= config.samples)
+            throw std::invalid_argument("Leak positions must be smaller than the number of samples.");
+    return positions;
+}
+
+/**
+ * Generate a set of multi-sample traces of the first round of AES: the output of the S-box of every key byte leaks
+ * at its sample, all the other samples are noise only. The noise follows an AR(1) process along the samples,
+ * n_t = correlation * n_(t-1) + sqrt(1 - correlation^2) * e_t, so every sample keeps the same variance.
+ * Traces are generated in parallel blocks of config.block_size traces, every block with its own random streams
+ * seeded from the simulator and the block index, so the output does not depend on the number of threads.
+ * @param n_trc the number of traces
+ * @param secret_key the 16 bytes of the secret key
+ * @param config the simulation configuration
+ * @param crypto_fun the cryptographic function
+ * @param lkg_fun the leakage function
+ * @return the plaintexts (n_trc x 16) and the traces (n_trc x samples), row-major and owned by the caller
+ */
+pair<double *, double *> Simulator::generate_traces_aes(
+        const uint32_t n_trc,
+        const uint8_t secret_key[AES_KEY_BYTES],
+        const AESSimulationConfig &config,
+        unsigned int (*crypto_fun)(const unsigned int, const unsigned int),
+        unsigned int (*lkg_fun)(const unsigned int)
+) {
+    auto positions = leak_positions(config);
+    // Throws on an invalid distribution type here, exceptions cannot leave the parallel region
+    get_distribution(config.distribution_type, config.sigma);
+    const uint32_t samples = config.samples;
+    const double correlation = config.correlation;
+    const double innovation = sqrt(1 - correlation * correlation);
+    const unsigned int base_seed = this->gen();
+    const int64_t blocks = ((int64_t) n_trc + config.block_size - 1) / config.block_size;
+    auto *pt_array = new double[(size_t) n_trc * AES_KEY_BYTES];
+    auto *tr_array = new double[(size_t) n_trc * samples];
+#pragma omp parallel for schedule(dynamic)
+    for (int64_t block = 0; block < blocks; block++) {
+        seed_seq pt_sequence{base_seed, (unsigned int) block, 0U};
+        seed_seq noise_sequence{base_seed, (unsigned int) block, 1U};
+        mt19937 pt_generator(pt_sequence);
+        default_random_engine noise_generator(noise_sequence);
+        uniform_int_distribution<int> byte(0, 255);
+        auto distribution_function = get_distribution(config.distribution_type, config.sigma);
+        uint64_t end = min((uint64_t) n_trc, (uint64_t) (block + 1) * config.block_size);
+        for (uint64_t i = (uint64_t) block * config.block_size; i < end; i++) {
+            double *pt = pt_array + i * AES_KEY_BYTES;
+            double *tr = tr_array + i * samples;
+            double noise = 0;
+            for (uint32_t t = 0; t < samples; t++) {
+                double e = distribution_function(noise_generator);
+                noise = t == 0 ? e : correlation * noise + innovation * e;
+                tr[t] = noise;
+            }
+            for (int b = 0; b < AES_KEY_BYTES; b++) {
+                pt[b] = byte(pt_generator);
+                tr[positions[b]] += lkg_fun(crypto_fun((unsigned int) pt[b], secret_key[b]));
+            }
+        }
+    }
+    return make_pair(pt_array, tr_array);
+}
+
+/**
+ * Simulates a set of multi-sample AES traces and writes them to a file
+ * @param n_trc the number of traces
+ * @param secret_key the 16 bytes of the secret key
+ * @param config the simulation configuration
+ * @param crypto_fun the cryptographic function
+ * @param lkg_fun the leakage function
+ * @return the filename
+ */
+string Simulator::simulate_traces_aes(
+        uint32_t n_trc,
+        const uint8_t secret_key[AES_KEY_BYTES],
+        const AESSimulationConfig &config,
+        unsigned int (*crypto_fun)(const unsigned int, const unsigned int),
+        unsigned int (*lkg_fun)(const unsigned int)
+) {
+    auto pts_traces = this->generate_traces_aes(n_trc, secret_key, config, crypto_fun, lkg_fun);
+    auto filename = MIUtils::generate_filename(n_trc, "aes_traces");
+    MIUtils::write_traces(filename, pts_traces.second, pts_traces.first, n_trc, config.samples, secret_key);
+    delete[] pts_traces.first;
+    delete[] pts_traces.second;
+    return filename;
+}
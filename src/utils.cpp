@@ -48,6 +48,7 @@ double *MIUtils::compute_distribution(const double *X, const int *sizes, int dim
  * @return The traces.
  */
 Trace MIUtils::read_traces(const string &filename) {
+    MI_TIME(HDF5_READ);
     Trace trace{};
     H5File file(filename, H5F_ACC_RDONLY);
     DataSet dataset = file.openDataSet("traces");
@@ -59,6 +60,8 @@ Trace MIUtils::read_traces(const string &filename) {
 
     trace.traces = new double[trace.dims[0] * trace.dims[1]];
     dataset.read(trace.traces, PredType::NATIVE_DOUBLE);
+    MI_COUNT(HDF5_READS, 1);
+    MI_COUNT(BYTES_RESERVED, trace.dims[0] * trace.dims[1] * sizeof(double));
 
     try {
         Attribute attribute = dataset.openAttribute("secret_key");
@@ -66,12 +69,25 @@ Trace MIUtils::read_traces(const string &filename) {
     } catch (const H5::AttributeIException &e) {
         cout << "Attribute not found" << "\n";
     }
+    trace.key[0] = trace.secret_key & 0xFF;
+    if (dataset.attrExists("key")) {
+        Attribute attribute = dataset.openAttribute("key");
+        attribute.read(PredType::NATIVE_UINT8, trace.key);
+    }
     dataspace.close();
     dataset.close();
 
     dataset = file.openDataSet("pts");
-    trace.pts = new double[trace.dims[0]];
+    dataspace = dataset.getSpace();
+    trace.pts_dims[0] = trace.dims[0];
+    trace.pts_dims[1] = 1;
+    if (dataspace.getSimpleExtentNdims() == 2)
+        dataspace.getSimpleExtentDims(trace.pts_dims, nullptr);
+    trace.pts = new double[trace.pts_dims[0] * trace.pts_dims[1]];
     dataset.read(trace.pts, PredType::NATIVE_DOUBLE);
+    MI_COUNT(HDF5_READS, 1);
+    MI_COUNT(BYTES_RESERVED, trace.pts_dims[0] * trace.pts_dims[1] * sizeof(double));
+    dataspace.close();
     dataset.close();
 
     return trace;
@@ -102,14 +118,89 @@ void MIUtils::write_traces(const string &filename, double *traces, double *pts,
     file.close();
 }
 
+/**
+ * Writes multi-sample traces of all the key bytes to an HDF5 file: an (size x samples) traces dataset, an
+ * (size x 16) pts dataset, the 16 key bytes in the key attribute and the first one in secret_key, so that readers of
+ * single byte files still work on byte 0.
+ * @param filename - The name of the file.
+ * @param traces - The traces, row-major.
+ * @param pts - The plaintexts, row-major.
+ * @param size - The number of traces.
+ * @param samples - The number of samples per trace.
+ * @param key - The 16 key bytes.
+ */
+void MIUtils::write_traces(const string &filename, double *traces, double *pts, uint32_t size, uint32_t samples,
+                           const uint8_t key[AES_KEY_BYTES]) {
+    H5File file(filename, H5F_ACC_TRUNC);
+    hsize_t pts_dims[2] = {static_cast<hsize_t>(size), AES_KEY_BYTES};
+    DataSpace pts_dataspace(2, pts_dims);
+    DataSet dataset = file.createDataSet("pts", PredType::NATIVE_DOUBLE, pts_dataspace);
+    dataset.write(pts, PredType::NATIVE_DOUBLE);
+    dataset.close();
+    hsize_t dims[2] = {static_cast<hsize_t>(size), static_cast<hsize_t>(samples)};
+    DataSpace dataspace(2, dims);
+    dataset = file.createDataSet("traces", PredType::NATIVE_DOUBLE, dataspace);
+    dataset.write(traces, PredType::NATIVE_DOUBLE);
+    hsize_t dim[] = {1};
+    DataSpace attr_dataspace = DataSpace(1, dim);
+    Attribute attribute = dataset.createAttribute("secret_key", PredType::NATIVE_INT, attr_dataspace);
+    unsigned int secret_key = key[0];
+    attribute.write(PredType::NATIVE_INT, &secret_key);
+    attribute.close();
+    hsize_t key_dim[] = {AES_KEY_BYTES};
+    DataSpace key_dataspace = DataSpace(1, key_dim);
+    Attribute key_attribute = dataset.createAttribute("key", PredType::NATIVE_UINT8, key_dataspace);
+    key_attribute.write(PredType::NATIVE_UINT8, key);
+    key_attribute.close();
+    dataset.close();
+    file.close();
+}
+
+/**
+ * Keeps only the plaintext column of one key byte, so that a multi-byte trace can be attacked like a single byte one.
+ * @param trace - The trace, modified in place.
+ * @param byte - The key byte.
+ */
+void MIUtils::select_byte(Trace &trace, int byte) {
+    if (byte < 0 || (hsize_t) byte >= trace.pts_dims[1])
+        throw std::invalid_argument("The key byte is not in the traces.");
+    if (trace.pts_dims[1] == 1)
+        return;
+    auto *pts = new double[trace.pts_dims[0]];
+    for (hsize_t i = 0; i < trace.pts_dims[0]; i++)
+        pts[i] = trace.pts[i * trace.pts_dims[1] + byte];
+    delete[] trace.pts;
+    trace.pts = pts;
+    trace.pts_dims[1] = 1;
+    trace.secret_key = trace.key[byte];
+}
+
+/**
+ * Keeps only some samples of every trace, e.g. the points of interest found by a leakage scan.
+ * @param trace - The trace, modified in place.
+ * @param samples - The indexes of the samples to keep, in the order they are kept.
+ */
+void MIUtils::select_samples(Trace &trace, const vector<int> &samples) {
+    if (samples.empty())
+        throw std::invalid_argument("At least one sample must be selected.");
+    for (int sample: samples)
+        if (sample < 0 || (hsize_t) sample >= trace.dims[1])
+            throw std::invalid_argument("The sample is not in the traces.");
+    auto *traces = new double[trace.dims[0] * samples.size()];
+    for (hsize_t i = 0; i < trace.dims[0]; i++)
+        for (size_t j = 0; j < samples.size(); j++)
+            traces[i * samples.size() + j] = trace.traces[i * trace.dims[1] + samples[j]];
+    delete[] trace.traces;
+    trace.traces = traces;
+    trace.dims[1] = samples.size();
+}
+
 /**
  * Generates a filename for the traces.
+ * @param n_trc - The number of traces.
+ * @param suffix - The suffix of the filename.
  * @return The filename.
  */
-std::string MIUtils::generate_filename(uint32_t n_trc) {
-    char filename[100];
-    strcpy(filename, "../data/traces/");
-    strcat(filename, to_string(n_trc).c_str());
-    strcat(filename, "_traces.h5");
-    return filename;
+std::string MIUtils::generate_filename(uint32_t n_trc, const std::string &suffix) {
+    return "../data/traces/" + to_string(n_trc) + "_" + suffix + ".h5";
 }
@@ -0,0 +1,24 @@
+#include "../include/evaluation.h"
+#include "../include/aes.h"
+#include <iostream>
+using namespace std;
+
+int main(int argc, char **argv) {
+    int repetitions = argc > 1 ? stoi(argv[1]) : 100;
+    uint32_t max_traces = argc > 2 ? stoul(argv[2]) : 1280;
+    double sigma = argc > 3 ? stod(argv[3]) : 1;
+    if (argc > 4 || repetitions <= 0 || max_traces < 10 || sigma <= 0) {
+        cout << "Usage: ./evaluate [repetitions > 0] [max_traces >= 10] [sigma > 0]" << "\n";
+        return 1;
+    }
+
+    vector<uint32_t> trace_counts;
+    for (uint32_t i = 10; i <= max_traces; i *= 2)
+        trace_counts.push_back(i);
+
+    auto evaluator = Evaluator(log10, 10, hw_pdf, aes_intermediate, hw);
+    auto summary = evaluator.evaluate(trace_counts, repetitions, "gauss", sigma, 0);
+    Evaluator::write_summary(cout, summary);
+    Instrumentation::write_json(cerr);
+    return 0;
+}
@@ -0,0 +1,42 @@
+#include "../include/monitor.h"
+#include "../include/simulator.h"
+#include "../include/aes.h"
+#include <iostream>
+using namespace std;
+
+int main(int argc, char **argv) {
+    uint32_t max_traces = argc > 1 ? stoul(argv[1]) : 100000;
+    double sigma = argc > 2 ? stod(argv[2]) : 1;
+    uint32_t batch = argc > 3 ? stoul(argv[3]) : 100;
+    int patience = argc > 4 ? stoi(argv[4]) : 5;
+    if (argc > 5 || sigma <= 0 || batch == 0 || patience <= 0) {
+        cout << "Usage: ./online_monitor [max_traces] [sigma > 0] [batch > 0] [patience > 0]" << "\n";
+        return 1;
+    }
+
+    Simulator sim;
+    unsigned int secret_key = sim.generate_random_byte();
+    auto monitor = OnlineMonitor(1, make_pair(-4 * sigma, 8 + 4 * sigma));
+    vector<double *> Y(batch);
+    unsigned int leader = 0;
+    int stable = 0;
+    while (monitor.traces() < max_traces && stable < patience) {
+        auto pts_traces = sim.generate_traces_1d(batch, secret_key, "gauss", sigma, aes_intermediate, hw);
+        for (uint32_t i = 0; i < batch; i++)
+            Y[i] = pts_traces.second + i;
+        monitor.update(pts_traces.first, Y.data(), (int) batch);
+        delete[] pts_traces.first;
+        delete[] pts_traces.second;
+
+        // Every query scores the 256 keys from scratch, so batches should be large compared to its cost
+        auto snapshot = monitor.query(MonitorEstimator::GAUSSIAN, aes_intermediate, hw);
+        stable = snapshot.best_key == leader ? stable + 1 : 1;
+        leader = snapshot.best_key;
+        cout << "Traces: " << snapshot.traces << ", key: " << snapshot.best_key << ", margin: " << snapshot.margin << "\n";
+    }
+
+    auto binned = monitor.query(MonitorEstimator::BINNED, aes_intermediate, hw);
+    cout << "Secret key: " << secret_key << ", Gaussian key: " << leader << ", binned key: " << binned.best_key
+         << " (margin " << binned.margin << ") after " << monitor.traces() << " traces" << "\n";
+    return 0;
+}
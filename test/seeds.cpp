@@ -0,0 +1,48 @@
+#include "../include/simulator.h"
+#include "../include/aes.h"
+#include <iostream>
+using namespace std;
+
+/**
+ * Noise of the simulated traces, the trace minus its Hamming weight leakage.
+ */
+vector<double> simulate_noise(unsigned int seed, uint32_t n_trc) {
+    Simulator sim(seed);
+    auto pts_traces = sim.generate_traces_1d(n_trc, 0x2B, "gauss", 1, aes_intermediate, hw);
+    vector<double> noise(n_trc);
+    for (uint32_t i = 0; i < n_trc; i++)
+        noise[i] = pts_traces.second[i] - hw(aes_intermediate((unsigned int) pts_traces.first[i], 0x2B));
+    delete[] pts_traces.first;
+    delete[] pts_traces.second;
+    return noise;
+}
+
+/**
+ * Whether two noise vectors are equal up to the rounding of the leakage subtraction.
+ */
+bool same_noise(const vector<double> &a, const vector<double> &b) {
+    for (size_t i = 0; i < a.size(); i++)
+        if (fabs(a[i] - b[i]) > 1e-9)
+            return false;
+    return true;
+}
+
+int main() {
+    // Evaluator::evaluate gives repetition r the seed seed + r, adjacent seeds must give independent noise and the
+    // same seed the same noise
+    const uint32_t n_trc = 1000;
+    bool ok = true;
+    for (unsigned int seed = 0; seed < 8; seed++) {
+        auto noise = simulate_noise(seed, n_trc);
+        if (!same_noise(noise, simulate_noise(seed, n_trc))) {
+            cout << "Seed " << seed << " is not reproducible" << "\n";
+            ok = false;
+        }
+        if (same_noise(noise, simulate_noise(seed + 1, n_trc))) {
+            cout << "Seeds " << seed << " and " << seed + 1 << " give the same noise" << "\n";
+            ok = false;
+        }
+    }
+    cout << (ok ? "OK" : "FAILED") << "\n";
+    return ok ? 0 : 1;
+}
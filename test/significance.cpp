@@ -0,0 +1,69 @@
+#include "../include/resampling.h"
+#include "../include/simulator.h"
+#include "../include/aes.h"
+#include <iostream>
+using namespace std;
+
+int main(int argc, char **argv) {
+    int traces = argc > 1 ? stoi(argv[1]) : 500;
+    int trials = argc > 2 ? stoi(argv[2]) : 40;
+    int permutations = argc > 3 ? stoi(argv[3]) : 99;
+    double sigma = argc > 4 ? stod(argv[4]) : 1;
+    if (argc > 5 || traces <= 0 || trials <= 0 || permutations <= 0 || sigma <= 0) {
+        cout << "Usage: ./significance [traces] [trials] [permutations] [sigma]" << "\n";
+        return 1;
+    }
+    const double alpha = 0.05;
+
+    Simulator sim(0);
+    unsigned int secret_key = sim.generate_random_byte();
+    auto pts_traces = sim.generate_traces_1d(traces, secret_key, "gauss", sigma, aes_intermediate, hw);
+    vector<double *> Y(traces);
+    for (int i = 0; i < traces; i++)
+        Y[i] = pts_traces.second + i;
+    auto range = minmax_element(pts_traces.second, pts_traces.second + traces);
+    int bins[1] = {10};
+    pair<double, double> ranges[1] = {make_pair(*range.first, *range.second)};
+    const auto hist_estimator = HistEstimator(1, bins, ranges);
+    const auto gkov_estimator = GKOVEstimator(log10);
+    auto resampler = Resampler(traces, 200, permutations, 0.95, 1);
+
+    // Under the secret key the leakage depends on the traces, reported for reference
+    vector<double> X(traces);
+    for (int i = 0; i < traces; i++)
+        X[i] = hw(aes_intermediate((int) pts_traces.first[i], secret_key));
+    auto hist = resampler.estimate(hist_estimator, X.data(), hw_pdf, pts_traces.second);
+    auto gkov = resampler.estimate(gkov_estimator, X.data(), Y.data(), 1);
+    cout << "Secret key Hist: " << hist.estimate << " [" << hist.ci_low << ", " << hist.ci_high << "], p = " << hist.p_value << "\n";
+    cout << "Secret key GKOV: " << gkov.estimate << " [" << gkov.ci_low << ", " << gkov.ci_high << "], p = " << gkov.p_value << "\n";
+    // Both estimators must report a proper interval: bootstrap for Hist, subsampling without replacement for GKOV
+    bool intervals = isfinite(hist.ci_low) && hist.ci_low <= hist.ci_high && isfinite(gkov.ci_low) && gkov.ci_low <= gkov.ci_high;
+    // Without resamples there is no interval, it must not be reported as [estimate, estimate]
+    auto no_interval = Resampler(traces, 0, 0, 0.95, 1).estimate(gkov_estimator, X.data(), Y.data(), 1);
+    intervals = intervals && isnan(no_interval.ci_low) && isnan(no_interval.ci_high);
+
+    // Under labels drawn independently of the traces the p-values must be uniform: at most alpha of them, up to
+    // three binomial standard deviations, may fall below alpha
+    mt19937 gen(2);
+    int hist_rejections = 0;
+    int gkov_rejections = 0;
+    for (int trial = 0; trial < trials; trial++) {
+        for (int i = 0; i < traces; i++)
+            X[i] = hw(aes_intermediate(gen() & 0xFF, secret_key));
+        auto null_resampler = Resampler(traces, 0, permutations, 0.95, 3 + trial);
+        hist_rejections += null_resampler.estimate(hist_estimator, X.data(), hw_pdf, pts_traces.second).p_value <= alpha;
+        gkov_rejections += null_resampler.estimate(gkov_estimator, X.data(), Y.data(), 1).p_value <= alpha;
+    }
+    double limit = alpha + 3 * sqrt(alpha * (1 - alpha) / trials);
+    double hist_rate = (double) hist_rejections / trials;
+    double gkov_rate = (double) gkov_rejections / trials;
+    cout << "Null rejection rate at " << alpha << ": Hist " << hist_rate << ", GKOV " << gkov_rate << " (limit " << limit << ")" << "\n";
+
+    delete[] pts_traces.first;
+    delete[] pts_traces.second;
+    bool calibrated = hist_rate <= limit && gkov_rate <= limit;
+    if (!intervals)
+        cout << "Confidence intervals are missing or empty" << "\n";
+    cout << (calibrated && intervals ? "OK" : "FAILED") << "\n";
+    return calibrated && intervals ? 0 : 1;
+}